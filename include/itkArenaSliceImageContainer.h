@@ -0,0 +1,86 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkArenaSliceImageContainer_h
+#define itkArenaSliceImageContainer_h
+
+#include "itkObjectFactory.h"
+
+namespace itk
+{
+
+/** \class ArenaSliceImageContainer
+ * \brief A pixel container importing a slice of a larger container,
+ * the arena, which it keeps alive.
+ *
+ * The slice does not manage its memory: the arena is released when
+ * the last of its slices, and the arena itself, are released. So the
+ * images importing a slice stay valid when the owner of the arena
+ * releases it.
+ *
+ * TContainer is the pixel container type of the images, usually an
+ * ImportImageContainer, and the type of the arena.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+template< class TContainer >
+class ArenaSliceImageContainer:
+  public TContainer
+{
+public:
+  /** Standard class typedefs. */
+  typedef ArenaSliceImageContainer   Self;
+  typedef TContainer                 Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  typedef TContainer                    ArenaType;
+  typedef typename ArenaType::Element   Element;
+
+  /** Standard New method. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(ArenaSliceImageContainer, TContainer);
+
+  /** Import the size elements of the arena starting at offset. */
+  void SetArenaSlice( ArenaType *arena, SizeValueType offset, SizeValueType size )
+  {
+    m_Arena = arena;
+    this->SetImportPointer( arena->GetBufferPointer() + offset, size, false );
+  }
+
+  /** Get the arena the slice is imported from. */
+  const ArenaType * GetArena() const
+  {
+    return m_Arena.GetPointer();
+  }
+
+protected:
+  ArenaSliceImageContainer() {}
+  ~ArenaSliceImageContainer() {}
+
+private:
+  ArenaSliceImageContainer(const Self &); //purposely not implemented
+  void operator=(const Self &);           //purposely not implemented
+
+  typename ArenaType::Pointer m_Arena;
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkAttributeImageCache_h
+#define itkAttributeImageCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+#include <list>
+#include <utility>
+
+namespace itk
+{
+
+/** \class AttributeImageCacheClient
+ * \brief Interface of the owners of the images held by an
+ * AttributeImageCache.
+ *
+ * LoadCachedImage makes the idx-th image resident, decompressing it
+ * if needed, and returns a reference to it. ReleaseCachedImage drops
+ * the resident copy of the idx-th image, which is freed with the last
+ * reference to it. Both are called by the cache with its lock held.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+class AttributeImageCacheClient
+{
+public:
+  virtual LightObject::Pointer LoadCachedImage( unsigned int idx ) const = 0;
+  virtual void ReleaseCachedImage( unsigned int idx ) const = 0;
+
+protected:
+  virtual ~AttributeImageCacheClient() {}
+};
+
+
+/** \class AttributeImageCache
+ * \brief Keeps the most recently used decompressed attribute images
+ * resident.
+ *
+ * The cache is shared by the label objects holding compressed
+ * attribute images. Each access to a compressed image goes through
+ * Load, which moves it to the front of the cache, and the least
+ * recently used images beyond MaximumNumberOfImages are released by
+ * their owner. Load returns a SmartPointer to the image taken with the
+ * lock held, so an image in use is not freed when it is released by
+ * another thread: the owner only drops its reference, and the pixels
+ * are kept in the compressed form.
+ *
+ * The cache is meant to be small: the images are looked up linearly.
+ * Load and Remove are thread safe.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+class AttributeImageCache : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef AttributeImageCache        Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Standard New method. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(AttributeImageCache, Object);
+
+  /** Set/Get the number of images kept resident. At least the last
+   * accessed image is kept. Defaults to 16.
+   */
+  itkSetMacro(MaximumNumberOfImages, SizeValueType);
+  itkGetConstMacro(MaximumNumberOfImages, SizeValueType);
+
+  /** Get the number of resident images. */
+  SizeValueType GetNumberOfImages() const
+  {
+    MutexLockHolder<SimpleFastMutexLock> lock( m_Mutex );
+    return static_cast<SizeValueType>( m_Entries.size() );
+  }
+
+  /** Make the idx-th image of the client resident, and release the
+   * least recently used images beyond the capacity of the cache. */
+  LightObject::Pointer Load( const AttributeImageCacheClient *client, unsigned int idx )
+  {
+    MutexLockHolder<SimpleFastMutexLock> lock( m_Mutex );
+
+    const EntryType entry( client, idx );
+    for ( EntryListType::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it )
+      {
+      if ( *it == entry )
+        {
+        m_Entries.erase( it );
+        break;
+        }
+      }
+    LightObject::Pointer image = client->LoadCachedImage( idx );
+    m_Entries.push_front( entry );
+
+    while ( m_Entries.size() > 1 && m_Entries.size() > m_MaximumNumberOfImages )
+      {
+      m_Entries.back().first->ReleaseCachedImage( m_Entries.back().second );
+      m_Entries.pop_back();
+      }
+    return image;
+  }
+
+  /** Forget the idx-th image of the client, without releasing it. */
+  void Remove( const AttributeImageCacheClient *client, unsigned int idx )
+  {
+    MutexLockHolder<SimpleFastMutexLock> lock( m_Mutex );
+    m_Entries.remove( EntryType( client, idx ) );
+  }
+
+  /** Forget all the images of the client, without releasing them. */
+  void Remove( const AttributeImageCacheClient *client )
+  {
+    MutexLockHolder<SimpleFastMutexLock> lock( m_Mutex );
+
+    EntryListType::iterator it = m_Entries.begin();
+    while ( it != m_Entries.end() )
+      {
+      if ( it->first == client )
+        {
+        it = m_Entries.erase( it );
+        }
+      else
+        {
+        ++it;
+        }
+      }
+  }
+
+protected:
+  AttributeImageCache()
+    : m_MaximumNumberOfImages( 16 )
+  {}
+
+  virtual void PrintSelf(std::ostream & os, Indent indent) const ITK_OVERRIDE
+  {
+    Superclass::PrintSelf(os, indent);
+    os << indent << "MaximumNumberOfImages: " << m_MaximumNumberOfImages << std::endl;
+    os << indent << "NumberOfImages: " << this->GetNumberOfImages() << std::endl;
+  }
+
+private:
+  AttributeImageCache(const Self &); //purposely not implemented
+  void operator=(const Self &);      //purposely not implemented
+
+  typedef std::pair< const AttributeImageCacheClient *, unsigned int > EntryType;
+  typedef std::list< EntryType >                                       EntryListType;
+
+  SizeValueType               m_MaximumNumberOfImages;
+  EntryListType               m_Entries;
+  mutable SimpleFastMutexLock m_Mutex;
+};
+
+} // end namespace itk
+
+#endif
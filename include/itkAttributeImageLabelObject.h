@@ -21,6 +21,10 @@
 #include "itkImage.h"
 #include "itkLabelMap.h"
 #include "itkShapeLabelObject.h"
+#include "itkAttributeImageCache.h"
+#include "itkImageRegionConstIterator.h"
+#include <cstring>
+#include <vector>
 
 namespace itk
 {
@@ -30,6 +34,23 @@ namespace itk
 /** \class AttributeImageLabelObject
  *  \brief A LabelObject with an image
  *
+ * The attribute images can be stored compressed with
+ * CompressAttributeImages, to keep the crops of many label objects in
+ * memory. The pixels are byte shuffled, the k-th bytes of all the
+ * pixels being grouped together, and run length encoded, which is
+ * efficient for the masked crops and the slowly varying high order
+ * bytes of the pixels. A compressed image is decompressed when it is
+ * accessed and stays resident until it is compressed again or, when
+ * an AttributeImageCache is set, released by the cache. Changes made
+ * to a decompressed image are lost when it is released by the cache,
+ * unless CompressAttributeImages is called first. Without a cache, a
+ * label object must not be accessed by several threads at once.
+ *
+ * The attribute images are returned as SmartPointers: an image
+ * released by the cache is only freed when the last SmartPointer to
+ * it is released, so it must be held as a SmartPointer while it is
+ * used when other label objects sharing the cache are accessed.
+ *
  * \ingroup DataRepresentation
  * \ingroup ITKOBBLabelMap
  */
@@ -37,7 +58,7 @@ template < class TLabel,
            unsigned int VImageDimension,
            class TAttributeImage = Image<TLabel, VImageDimension>,
            class TSuperclass = ShapeLabelObject<TLabel, VImageDimension> >
-class AttributeImageLabelObject : public TSuperclass
+class AttributeImageLabelObject : public TSuperclass, public AttributeImageCacheClient
 {
 public:
   /** Standard class typedefs */
@@ -57,19 +78,162 @@ public:
 
   typedef LabelMap< TSuperclass > LabelMapType;
 
-  typedef TAttributeImage AttributeImageType;
+  typedef TAttributeImage                       AttributeImageType;
+  typedef typename AttributeImageType::PixelType AttributeImagePixelType;
+
+  /** Binary image on the grid of the attribute image, non-zero where
+   * the pixel is in the label object. */
+  typedef Image<unsigned char, VImageDimension> MaskImageType;
 
   void SetAttributeImage( AttributeImageType* i  )
   {
-    m_AttributeImage = i;
+    this->SetNthAttributeImage( 0, i );
+  }
+  typename AttributeImageType::ConstPointer GetAttributeImage() const
+  {
+    return this->GetNthAttributeImage( 0 );
+  }
+  typename AttributeImageType::Pointer GetAttributeImage()
+  {
+    return this->GetNthAttributeImage( 0 );
+  }
+
+  /** The attribute images are indexed, the AttributeImage is the 0-th
+   * one. */
+  void SetNthAttributeImage( unsigned int idx, AttributeImageType* i )
+  {
+    if ( idx >= m_AttributeImages.size() )
+      {
+      this->SetNumberOfAttributeImages( idx + 1 );
+      }
+    this->ForgetCompressedImage( idx );
+    m_AttributeImages[idx] = i;
+  }
+  typename AttributeImageType::ConstPointer GetNthAttributeImage( unsigned int idx ) const
+  {
+    return this->AccessNthAttributeImage( idx ).GetPointer();
+  }
+  typename AttributeImageType::Pointer GetNthAttributeImage( unsigned int idx )
+  {
+    return this->AccessNthAttributeImage( idx );
+  }
+
+  void SetNumberOfAttributeImages( unsigned int n )
+  {
+    for ( unsigned int i = n; i < m_AttributeImages.size(); ++i )
+      {
+      this->ForgetCompressedImage( i );
+      }
+    m_AttributeImages.resize( n );
+    m_CompressedAttributeImages.resize( n );
+  }
+  unsigned int GetNumberOfAttributeImages() const
+  {
+    return static_cast<unsigned int>( m_AttributeImages.size() );
+  }
+
+  void SetMaskImage( MaskImageType* i  )
+  {
+    m_MaskImage = i;
+  }
+  const MaskImageType* GetMaskImage() const
+  {
+    return m_MaskImage.GetPointer();
   }
-  const AttributeImageType* GetAttributeImage() const
+  MaskImageType* GetMaskImage()
   {
-    return m_AttributeImage.GetPointer();
+    return m_MaskImage.GetPointer();
   }
-  AttributeImageType* GetAttributeImage()
+
+  /** Compress the resident attribute images, and release them. The
+   * images already compressed and not accessed since are left as
+   * they are. Only the LargestPossibleRegion of an image is kept, so a
+   * view of a larger buffer is compressed as a copy of its region. */
+  void CompressAttributeImages()
+  {
+    for ( unsigned int i = 0; i < m_AttributeImages.size(); ++i )
+      {
+      const AttributeImageType *image = m_AttributeImages[i].GetPointer();
+      if ( image == ITK_NULLPTR )
+        {
+        continue;
+        }
+      this->ForgetCompressedImage( i );
+
+      const typename AttributeImageType::RegionType & region = image->GetLargestPossibleRegion();
+
+      CompressedImageType & compressed = m_CompressedAttributeImages[i];
+      compressed.Information = AttributeImageType::New();
+      compressed.Information->CopyInformation( image );
+      compressed.Information->SetBufferedRegion( region );
+
+      if ( image->GetBufferedRegion() == region )
+        {
+        EncodePixels( reinterpret_cast<const unsigned char *>( image->GetBufferPointer() ),
+                      region.GetNumberOfPixels(), sizeof( AttributeImagePixelType ), compressed.Data );
+        }
+      else
+        {
+        std::vector<AttributeImagePixelType> pixels;
+        pixels.reserve( region.GetNumberOfPixels() );
+        for ( ImageRegionConstIterator<AttributeImageType> it( image, region ); !it.IsAtEnd(); ++it )
+          {
+          pixels.push_back( it.Get() );
+          }
+        EncodePixels( reinterpret_cast<const unsigned char *>( pixels.empty() ? ITK_NULLPTR : &pixels[0] ),
+                      region.GetNumberOfPixels(), sizeof( AttributeImagePixelType ), compressed.Data );
+        }
+      m_AttributeImages[i] = ITK_NULLPTR;
+      }
+  }
+
+  /** Get the number of bytes of the compressed attribute images. */
+  SizeValueType GetCompressedAttributeImagesSize() const
+  {
+    SizeValueType size = 0;
+    for ( unsigned int i = 0; i < m_CompressedAttributeImages.size(); ++i )
+      {
+      size += static_cast<SizeValueType>( m_CompressedAttributeImages[i].Data.size() );
+      }
+    return size;
+  }
+
+  /** Set/Get the cache of the decompressed attribute images. The cache
+   * may be shared by several label objects. */
+  void SetAttributeImageCache( AttributeImageCache *cache )
   {
-    return m_AttributeImage.GetPointer();
+    if ( m_AttributeImageCache.IsNotNull() )
+      {
+      m_AttributeImageCache->Remove( this );
+      }
+    m_AttributeImageCache = cache;
+  }
+  AttributeImageCache * GetAttributeImageCache() const
+  {
+    return m_AttributeImageCache.GetPointer();
+  }
+
+  virtual LightObject::Pointer LoadCachedImage( unsigned int idx ) const ITK_OVERRIDE
+  {
+    if ( m_AttributeImages[idx].IsNull() )
+      {
+      const CompressedImageType & compressed = m_CompressedAttributeImages[idx];
+
+      typename AttributeImageType::Pointer image = AttributeImageType::New();
+      image->CopyInformation( compressed.Information );
+      image->SetBufferedRegion( compressed.Information->GetBufferedRegion() );
+      image->SetRequestedRegion( compressed.Information->GetBufferedRegion() );
+      image->Allocate();
+      DecodePixels( compressed.Data, image->GetBufferedRegion().GetNumberOfPixels(), sizeof( AttributeImagePixelType ),
+                    reinterpret_cast<unsigned char *>( image->GetBufferPointer() ) );
+      m_AttributeImages[idx] = image;
+      }
+    return m_AttributeImages[idx].GetPointer();
+  }
+
+  virtual void ReleaseCachedImage( unsigned int idx ) const ITK_OVERRIDE
+  {
+    m_AttributeImages[idx] = ITK_NULLPTR;
   }
 
   virtual void CopyAttributesFrom( const LabelObjectType * lo ) ITK_OVERRIDE
@@ -82,26 +246,65 @@ public:
       {
       return;
       }
-    this->m_AttributeImage = src->m_AttributeImage;
+    this->SetNumberOfAttributeImages( 0 );
+    this->m_AttributeImages = src->m_AttributeImages;
+    this->m_CompressedAttributeImages = src->m_CompressedAttributeImages;
+    this->SetAttributeImageCache( src->m_AttributeImageCache );
+    this->m_MaskImage = src->m_MaskImage;
+
+    // the resident copies of the compressed images are tracked by the
+    // cache, as those of the source
+    if ( m_AttributeImageCache.IsNotNull() )
+      {
+      for ( unsigned int i = 0; i < m_AttributeImages.size(); ++i )
+        {
+        if ( m_AttributeImages[i].IsNotNull() && m_CompressedAttributeImages[i].Information.IsNotNull() )
+          {
+          m_AttributeImageCache->Load( this, i );
+          }
+        }
+      }
     }
 
 protected:
   AttributeImageLabelObject() { }
 
+  ~AttributeImageLabelObject()
+  {
+    this->SetAttributeImageCache( ITK_NULLPTR );
+  }
+
 
   void PrintSelf(std::ostream& os, Indent indent) const ITK_OVERRIDE
     {
     Superclass::PrintSelf( os, indent );
 
-    os << indent << "AttributeImage: ";
+    os << indent << "AttributeImages: " << m_AttributeImages.size() << std::endl;
+    for ( unsigned int i = 0; i < m_AttributeImages.size(); ++i )
+      {
+      os << indent.GetNextIndent() << i << ": ";
+      if ( m_AttributeImages[i].IsNull() )
+        {
+        os << "NULL" << std::endl;
+        }
+      else
+        {
+        os << m_AttributeImages[i] << std::endl;
+        }
+      }
+
+    os << indent << "CompressedAttributeImagesSize: " << this->GetCompressedAttributeImagesSize() << std::endl;
+    os << indent << "AttributeImageCache: " << m_AttributeImageCache.GetPointer() << std::endl;
+
+    os << indent << "MaskImage: ";
 
-    if ( m_AttributeImage.IsNull() )
+    if ( m_MaskImage.IsNull() )
       {
       os << "NULL" << std::endl;
       }
     else
       {
-      os << m_AttributeImage << std::endl;
+      os << m_MaskImage << std::endl;
       }
     }
 
@@ -109,7 +312,151 @@ private:
   AttributeImageLabelObject(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
 
-  typename AttributeImageType::Pointer m_AttributeImage;
+  // the geometry of a compressed image, without buffer, and its
+  // encoded pixels
+  struct CompressedImageType
+  {
+    typename AttributeImageType::Pointer Information;
+    std::vector<unsigned char>           Data;
+  };
+
+  typename AttributeImageType::Pointer AccessNthAttributeImage( unsigned int idx ) const
+  {
+    if ( idx >= m_AttributeImages.size() )
+      {
+      return ITK_NULLPTR;
+      }
+    if ( m_CompressedAttributeImages[idx].Information.IsNull() )
+      {
+      return m_AttributeImages[idx];
+      }
+
+    // the image is referenced before the lock of the cache is
+    // released, so it can not be freed by another thread
+    LightObject::Pointer image;
+    if ( m_AttributeImageCache.IsNotNull() )
+      {
+      image = m_AttributeImageCache->Load( this, idx );
+      }
+    else
+      {
+      image = this->LoadCachedImage( idx );
+      }
+    return static_cast<AttributeImageType *>( image.GetPointer() );
+  }
+
+  // drop the compressed copy of the idx-th image
+  void ForgetCompressedImage( unsigned int idx )
+  {
+    if ( idx >= m_CompressedAttributeImages.size() || m_CompressedAttributeImages[idx].Information.IsNull() )
+      {
+      return;
+      }
+    if ( m_AttributeImageCache.IsNotNull() )
+      {
+      m_AttributeImageCache->Remove( this, idx );
+      }
+    m_CompressedAttributeImages[idx] = CompressedImageType();
+  }
+
+  // The n pixels of pixelSize bytes are byte shuffled, then packed as
+  // runs: a header h < 128 is followed by h+1 literal bytes, and a
+  // header h >= 128 by a byte repeated h-125 times.
+  static void EncodePixels( const unsigned char *pixels, SizeValueType n, unsigned int pixelSize,
+                            std::vector<unsigned char> &data )
+  {
+    const SizeValueType numberOfBytes = n * pixelSize;
+    std::vector<unsigned char> shuffled( numberOfBytes );
+    for ( SizeValueType i = 0; i < n; ++i )
+      {
+      for ( unsigned int k = 0; k < pixelSize; ++k )
+        {
+        shuffled[k * n + i] = pixels[i * pixelSize + k];
+        }
+      }
+
+    data.clear();
+    SizeValueType literal = 0;
+    SizeValueType j = 0;
+    while ( j < numberOfBytes )
+      {
+      SizeValueType run = 1;
+      while ( j + run < numberOfBytes && run < 130 && shuffled[j + run] == shuffled[j] )
+        {
+        ++run;
+        }
+      if ( run >= 3 )
+        {
+        FlushLiteral( shuffled, j, literal, data );
+        data.push_back( static_cast<unsigned char>( run + 125 ) );
+        data.push_back( shuffled[j] );
+        j += run;
+        }
+      else
+        {
+        ++literal;
+        ++j;
+        if ( literal == 128 )
+          {
+          FlushLiteral( shuffled, j, literal, data );
+          }
+        }
+      }
+    FlushLiteral( shuffled, j, literal, data );
+
+    // release the memory of the over allocation
+    std::vector<unsigned char>( data ).swap( data );
+  }
+
+  static void FlushLiteral( const std::vector<unsigned char> &shuffled, SizeValueType end, SizeValueType &literal,
+                            std::vector<unsigned char> &data )
+  {
+    if ( literal == 0 )
+      {
+      return;
+      }
+    data.push_back( static_cast<unsigned char>( literal - 1 ) );
+    data.insert( data.end(), shuffled.begin() + ( end - literal ), shuffled.begin() + end );
+    literal = 0;
+  }
+
+  static void DecodePixels( const std::vector<unsigned char> &data, SizeValueType n, unsigned int pixelSize,
+                            unsigned char *pixels )
+  {
+    const SizeValueType numberOfBytes = n * pixelSize;
+    std::vector<unsigned char> shuffled( numberOfBytes );
+
+    SizeValueType j = 0;
+    SizeValueType d = 0;
+    while ( d < data.size() && j < numberOfBytes )
+      {
+      const unsigned int header = data[d++];
+      if ( header < 128 )
+        {
+        std::memcpy( &shuffled[j], &data[d], header + 1 );
+        d += header + 1;
+        j += header + 1;
+        }
+      else
+        {
+        std::memset( &shuffled[j], data[d++], header - 125 );
+        j += header - 125;
+        }
+      }
+
+    for ( SizeValueType i = 0; i < n; ++i )
+      {
+      for ( unsigned int k = 0; k < pixelSize; ++k )
+        {
+        pixels[i * pixelSize + k] = shuffled[k * n + i];
+        }
+      }
+  }
+
+  mutable std::vector< typename AttributeImageType::Pointer > m_AttributeImages;
+  std::vector< CompressedImageType >                          m_CompressedAttributeImages;
+  AttributeImageCache::Pointer                                m_AttributeImageCache;
+  typename MaskImageType::Pointer                             m_MaskImage;
 
 };
 
@@ -0,0 +1,135 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkAttributeIntensityMapping_h
+#define itkAttributeIntensityMapping_h
+
+#include "itkNumericTraits.h"
+#include "itkIndent.h"
+#include "itkMacro.h"
+
+namespace itk
+{
+namespace Functor
+{
+
+/** \class AttributeIntensityMapping
+ * \brief Map a feature value to an attribute pixel, as
+ * (v+Shift)*Scale clamped to [OutputMinimum,OutputMaximum].
+ *
+ * The mapping of the attribute image filters of this module, which
+ * forward their Shift, Scale, OutputMinimum and OutputMaximum to
+ * it. The defaults, 0, 1 and the range of TOutput, store the values
+ * as they are.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+template< class TOutput >
+class AttributeIntensityMapping
+{
+public:
+  AttributeIntensityMapping()
+    : m_Shift( 0.0 ),
+      m_Scale( 1.0 ),
+      m_OutputMinimum( NumericTraits< TOutput >::NonpositiveMin() ),
+      m_OutputMaximum( NumericTraits< TOutput >::max() )
+  {}
+
+  /** Set the members, and return whether they changed. */
+  bool SetShift( double shift ) { return Assign( m_Shift, shift ); }
+  bool SetScale( double scale ) { return Assign( m_Scale, scale ); }
+  bool SetOutputMinimum( TOutput minimum ) { return Assign( m_OutputMinimum, minimum ); }
+  bool SetOutputMaximum( TOutput maximum ) { return Assign( m_OutputMaximum, maximum ); }
+
+  double GetShift() const { return m_Shift; }
+  double GetScale() const { return m_Scale; }
+  TOutput GetOutputMinimum() const { return m_OutputMinimum; }
+  TOutput GetOutputMaximum() const { return m_OutputMaximum; }
+
+  /** Set the Shift and Scale so that the window of feature values is
+   * mapped onto [OutputMinimum,OutputMaximum], as
+   * IntensityWindowingImageFilter does, and return whether they
+   * changed. Throws an exception when the window is empty. */
+  bool SetIntensityWindow( double windowMinimum, double windowMaximum )
+  {
+    if ( windowMaximum <= windowMinimum )
+      {
+      itkGenericExceptionMacro("The intensity window [" << windowMinimum << "," << windowMaximum << "] is empty");
+      }
+
+    const double scale = ( static_cast<double>( m_OutputMaximum ) - static_cast<double>( m_OutputMinimum ) )
+      / ( windowMaximum - windowMinimum );
+    const bool scaleChanged = this->SetScale( scale );
+    const bool shiftChanged = this->SetShift( static_cast<double>( m_OutputMinimum ) / scale - windowMinimum );
+    return scaleChanged || shiftChanged;
+  }
+
+  /** Whether the values are stored as they are, without Shift, Scale
+   * or clamping. */
+  bool IsIdentity() const
+  {
+    return m_Shift == 0.0 && m_Scale == 1.0
+      && m_OutputMinimum == NumericTraits< TOutput >::NonpositiveMin()
+      && m_OutputMaximum == NumericTraits< TOutput >::max();
+  }
+
+  inline TOutput operator()( double value ) const
+  {
+    value = ( value + m_Shift ) * m_Scale;
+    if ( value <= static_cast<double>( m_OutputMinimum ) )
+      {
+      return m_OutputMinimum;
+      }
+    if ( value >= static_cast<double>( m_OutputMaximum ) )
+      {
+      return m_OutputMaximum;
+      }
+    return static_cast<TOutput>( value );
+  }
+
+  void Print( std::ostream & os, Indent indent ) const
+  {
+    os << indent << "Shift: " << m_Shift << std::endl;
+    os << indent << "Scale: " << m_Scale << std::endl;
+    os << indent << "OutputMinimum: "
+       << static_cast<typename NumericTraits< TOutput >::PrintType>( m_OutputMinimum ) << std::endl;
+    os << indent << "OutputMaximum: "
+       << static_cast<typename NumericTraits< TOutput >::PrintType>( m_OutputMaximum ) << std::endl;
+  }
+
+private:
+  template< class T >
+  static bool Assign( T &member, const T &value )
+  {
+    if ( member == value )
+      {
+      return false;
+      }
+    member = value;
+    return true;
+  }
+
+  double  m_Shift;
+  double  m_Scale;
+  TOutput m_OutputMinimum;
+  TOutput m_OutputMaximum;
+};
+
+} // end namespace Functor
+} // end namespace itk
+
+#endif
@@ -20,6 +20,14 @@
 
 #include "itkInPlaceLabelMapFilter.h"
 #include "itkShapeLabelMapFilter.h"
+#include "itkScheduledLabelMapFilter.h"
+#include "itkArenaSliceImageContainer.h"
+#include "itkAttributeIntensityMapping.h"
+#include "itkImageIOBase.h"
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace itk
 {
@@ -27,6 +35,59 @@ namespace itk
 template< class TImage, class TLabelImage > class ShapeLabelMapFilter;
 
 /** \class BoundingBoxImageLabelMapFilter
+ * \brief Crops the feature image to the bounding box of each label
+ * object.
+ *
+ * The crop is copied line by line into the attribute image, with the
+ * conversion to the attribute pixel type. The value v of the feature
+ * image is stored as (v+Shift)*Scale clamped to
+ * [OutputMinimum,OutputMaximum], so a narrow attribute pixel type can
+ * be filled in the same pass, see SetIntensityWindow.
+ *
+ * With UseLabelObjectMask, the attribute image is filled with the
+ * DefaultPixelValue and only the runs of the RLE lines of the label
+ * object are copied, so the copy costs about the number of pixels of
+ * the label object instead of the volume of its bounding box. Without
+ * mapping, when the pixel types are the same, the runs are copied
+ * with memcpy.
+ *
+ * With UseFeatureImageView, nothing is copied: the attribute image of
+ * each label object is a view sharing the pixel container of the
+ * feature image, whose LargestPossibleRegion and RequestedRegion are
+ * the bounding box while the BufferedRegion is the one of the feature
+ * image. The views are in the index space of the feature image, so
+ * they must be iterated over their LargestPossibleRegion, and they
+ * keep the buffer of the feature image alive. The buffer is shared,
+ * not copied on write: writing to a view modifies the feature image
+ * and every overlapping view, and when the filter producing the
+ * feature image executes again into the same buffer, the views of
+ * the previous update see the new values. The views should be
+ * treated as read only. This requires the AttributeImageType to be
+ * the FeatureImageType, without intensity mapping.
+ *
+ * With ArenaAllocation, the copies of all the bounding boxes are made
+ * into a single buffer, the AttributeImageArena, sized in
+ * BeforeThreadedGenerateData from the RLE lines of the label objects.
+ * Each attribute image imports its slice of the arena, and the slices
+ * follow the order of the labels in the label map. Each slice keeps a
+ * reference to the arena, which is released with the last attribute
+ * image using it.
+ *
+ * With a FeatureImageFileName, the feature image is not an input of
+ * the filter but is read from the file by the FeatureImageIO, which
+ * must be able to read regions. After the shape attributes are
+ * computed, the padded bounding boxes are sorted along the last
+ * dimension and merged into a few coalesced regions: a bounding box
+ * joins the current region while the union is at most twice the size
+ * of its bounding boxes and fits in the ReadMemoryBudget. Each region
+ * is read once and the crops of its label objects are cut from it. A
+ * bounding box larger than the budget is read alone, by slabs along
+ * the last dimension, so the memory used by the reads is bounded by
+ * the budget, or by a slice of the largest bounding box, instead of
+ * the size of the feature image. A bounding box read alone is read
+ * straight into its attribute image when the pixel types are the
+ * same, without intensity mapping or UseLabelObjectMask.
+ *
  * \ingroup ITKLabelMap
  * \ingroup ITKOBBLabelMap
  */
@@ -35,14 +96,14 @@ template< class TImage,
           class TFeatureImage = typename TImage::LabelObjectType::AttributeImageType,
           class TSuperclass = ShapeLabelMapFilter<TImage> >
 class BoundingBoxImageLabelMapFilter:
-  public TSuperclass
+  public ScheduledLabelMapFilter< TSuperclass >
 {
 public:
   /** Standard class typedefs. */
-  typedef BoundingBoxImageLabelMapFilter    Self;
-  typedef TSuperclass                       Superclass;
-  typedef SmartPointer< Self >              Pointer;
-  typedef SmartPointer< const Self >        ConstPointer;
+  typedef BoundingBoxImageLabelMapFilter          Self;
+  typedef ScheduledLabelMapFilter< TSuperclass >  Superclass;
+  typedef SmartPointer< Self >                    Pointer;
+  typedef SmartPointer< const Self >              ConstPointer;
 
   /** Some convenient typedefs. */
   typedef TImage                               ImageType;
@@ -53,9 +114,18 @@ public:
   typedef typename ImageType::OffsetType       OffsetType;
   typedef typename ImageType::SizeType         SizeType;
   typedef typename ImageType::LabelObjectType  LabelObjectType;
+  typedef typename LabelObjectType::LabelType  LabelType;
 
   typedef TFeatureImage                                FeatureImageType;
+  typedef typename FeatureImageType::Pointer           FeatureImagePointer;
+  typedef typename FeatureImageType::PixelType         FeaturePixelType;
   typedef typename LabelObjectType::AttributeImageType AttributeImageType;
+  typedef typename AttributeImageType::PixelType       AttributeImagePixelType;
+  typedef typename AttributeImageType::Pointer         AttributeImagePointer;
+  typedef typename AttributeImageType::PixelContainer  AttributeImagePixelContainerType;
+  typedef typename ImageType::RegionType               RegionType;
+
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
 
   /** ImageDimension constants */
   itkStaticConstMacro(ImageDimension, unsigned int, TImage::ImageDimension);
@@ -64,7 +134,7 @@ public:
   itkNewMacro(Self);
 
   /** Runtime information support. */
-  itkTypeMacro(BoundingBoxImageLabelMapFilter, TSuperclass);
+  itkTypeMacro(BoundingBoxImageLabelMapFilter, ScheduledLabelMapFilter);
 
   itkSetInputMacro(FeatureImage, FeatureImageType);
   itkGetInputMacro(FeatureImage, FeatureImageType);
@@ -77,19 +147,204 @@ public:
   itkGetConstMacro(PaddingOffset, OffsetType);
   void SetPaddingOffset( typename OffsetType::OffsetValueType o );
 
+  typedef Functor::AttributeIntensityMapping< AttributeImagePixelType > IntensityMappingType;
+
+  /** Set/Get the linear mapping of the feature values, (v+Shift)*Scale.
+   * Defaults to 0 and 1. */
+  void SetShift( double shift ) { if ( m_IntensityMapping.SetShift( shift ) ) { this->Modified(); } }
+  double GetShift() const { return m_IntensityMapping.GetShift(); }
+  void SetScale( double scale ) { if ( m_IntensityMapping.SetScale( scale ) ) { this->Modified(); } }
+  double GetScale() const { return m_IntensityMapping.GetScale(); }
+
+  /** Set/Get the range the mapped values are clamped to. Defaults to
+   * the range of the attribute pixel type. */
+  void SetOutputMinimum( AttributeImagePixelType minimum )
+    { if ( m_IntensityMapping.SetOutputMinimum( minimum ) ) { this->Modified(); } }
+  AttributeImagePixelType GetOutputMinimum() const { return m_IntensityMapping.GetOutputMinimum(); }
+  void SetOutputMaximum( AttributeImagePixelType maximum )
+    { if ( m_IntensityMapping.SetOutputMaximum( maximum ) ) { this->Modified(); } }
+  AttributeImagePixelType GetOutputMaximum() const { return m_IntensityMapping.GetOutputMaximum(); }
+
+  /** Set the Shift and Scale so that the window of feature values is
+   * mapped onto [OutputMinimum,OutputMaximum], as
+   * IntensityWindowingImageFilter does. */
+  void SetIntensityWindow( double windowMinimum, double windowMaximum )
+    { if ( m_IntensityMapping.SetIntensityWindow( windowMinimum, windowMaximum ) ) { this->Modified(); } }
+
+  /** Set/Get whether only the pixels of the label object are copied,
+   * the other pixels of the bounding box being set to the
+   * DefaultPixelValue. It is not used with UseFeatureImageView.
+   *
+   * Defaults to false.
+   **/
+  itkSetMacro(UseLabelObjectMask, bool);
+  itkGetConstMacro(UseLabelObjectMask, bool);
+  itkBooleanMacro(UseLabelObjectMask);
+
+  /** Set/Get the value of the pixels outside of the label object with
+   * UseLabelObjectMask. The DefaultPixelValue is not mapped. Defaults
+   * to zero.
+   */
+  itkSetMacro(DefaultPixelValue, AttributeImagePixelType);
+  itkGetConstReferenceMacro(DefaultPixelValue, AttributeImagePixelType);
+
+  /** Set/Get whether the attribute images are views of the buffer of
+   * the feature image instead of copies of the bounding box. Writes
+   * to a view go to the feature image, see the class documentation.
+   *
+   * Defaults to false.
+   **/
+  itkSetMacro(UseFeatureImageView, bool);
+  itkGetConstMacro(UseFeatureImageView, bool);
+  itkBooleanMacro(UseFeatureImageView);
+
+  /** Set/Get whether the copies of the bounding boxes are allocated in
+   * the single AttributeImageArena, instead of one buffer per label
+   * object. It is not used with UseFeatureImageView.
+   *
+   * Defaults to false.
+   **/
+  itkSetMacro(ArenaAllocation, bool);
+  itkGetConstMacro(ArenaAllocation, bool);
+  itkBooleanMacro(ArenaAllocation);
+
+  /** Get the buffer holding the pixels of all the attribute images
+   * of the last update with ArenaAllocation, NULL otherwise. The
+   * arena is shared by the filter and the attribute images, so the
+   * attribute images stay valid after the filter is updated again or
+   * destroyed. */
+  itkGetModifiableObjectMacro(AttributeImageArena, AttributeImagePixelContainerType);
+
+  /** Set/Get the file the feature image is read from, by regions, when
+   * not empty. The FeatureImage input is then not required.
+   **/
+  virtual void SetFeatureImageFileName( const std::string & fileName );
+  itkGetStringMacro(FeatureImageFileName);
+
+  /** Set/Get the ImageIO reading the regions of the
+   * FeatureImageFileName. */
+  itkSetObjectMacro(FeatureImageIO, ImageIOBase);
+  itkGetModifiableObjectMacro(FeatureImageIO, ImageIOBase);
+
+  /** Set/Get the number of bytes of a coalesced read of the
+   * FeatureImageFileName. A single bounding box larger than the budget
+   * is read by slabs of at least one slice. Defaults to 256MB.
+   */
+  itkSetMacro(ReadMemoryBudget, SizeValueType);
+  itkGetConstMacro(ReadMemoryBudget, SizeValueType);
+
+  /** Get the number of regions read from the FeatureImageFileName by
+   * the last update. */
+  itkGetConstMacro(NumberOfFeatureImageReads, SizeValueType);
+
 protected:
   BoundingBoxImageLabelMapFilter();
 
   virtual void ThreadedProcessLabelObject(LabelObjectType *labelObject) ITK_OVERRIDE;
 
+  virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  virtual void AfterThreadedGenerateData() ITK_OVERRIDE;
+
   virtual void PrintSelf(std::ostream & os, Indent indent) const ITK_OVERRIDE;
 
+  /** Create a view of region of the feature image, sharing its pixel
+   * container. A null pointer is returned when the feature image type
+   * is not the attribute image type. */
+  static AttributeImagePointer CreateFeatureImageView( const AttributeImageType *feature, const RegionType &region );
+
+  template< class TOtherImage >
+  static AttributeImagePointer CreateFeatureImageView( const TOtherImage *, const RegionType & )
+    {
+    return ITK_NULLPTR;
+    }
+
+  /** Copy the bounding box bb of the buffered region of feature into
+   * the attribute image of the label object, mapping the values. */
+  void CopyCropRegion( LabelObjectType *labelObject, const FeatureImageType *feature, const RegionType &bb ) const;
+
+  /** Create the attribute image of the bounding box bb of a label
+   * object, with the geometry of feature, in the slice of the arena
+   * of the label object when there is one. */
+  AttributeImagePointer CreateAttributeImage( const LabelObjectType *labelObject,
+                                              const FeatureImageType *feature,
+                                              const RegionType &bb ) const;
+
+  /** Copy the part of the bounding box bb in the buffered region of
+   * feature into attributeImage, mapping the values. */
+  void CopyCropLines( const LabelObjectType *labelObject,
+                      const FeatureImageType *feature,
+                      const RegionType &bb,
+                      AttributeImageType *attributeImage ) const;
+
+  /** Copy n values of the feature image to the attribute image,
+   * mapping the values. */
+  template< class TInputPixel >
+  void CopyPixels( const TInputPixel *input, AttributeImagePixelType *output, SizeValueType n ) const;
+
+  /** Same as above, with memcpy when there is no mapping. */
+  void CopyPixels( const AttributeImagePixelType *input, AttributeImagePixelType *output, SizeValueType n ) const;
+
+  /** Pad the bounding box of a label object with the PaddingOffset and
+   * crop it to the region of the feature image. Returns false when the
+   * bounding box can not be shrunk or is outside of the region. */
+  bool ComputeCropRegion( RegionType &bb, const RegionType &featureRegion ) const;
+
+  /** Compute the bounding box of the indexes of a label object from its
+   * lines. */
+  static RegionType ComputeBoundingBox( const LabelObjectType *labelObject );
+
 private:
   BoundingBoxImageLabelMapFilter(const Self &); //purposely not implemented
   void operator=(const Self &);      //purposely not implemented
 
   OffsetType m_PaddingOffset;
 
+  IntensityMappingType    m_IntensityMapping;
+
+  bool                    m_UseLabelObjectMask;
+  AttributeImagePixelType m_DefaultPixelValue;
+
+  bool m_UseFeatureImageView;
+  bool m_ArenaAllocation;
+
+  typename AttributeImagePixelContainerType::Pointer m_AttributeImageArena;
+  std::map< LabelType, SizeValueType >              m_ArenaOffsets;
+
+  std::string            m_FeatureImageFileName;
+  ImageIOBase::Pointer   m_FeatureImageIO;
+  SizeValueType          m_ReadMemoryBudget;
+  SizeValueType          m_NumberOfFeatureImageReads;
+
+  // the geometry of the FeatureImageFileName, without buffer
+  FeatureImagePointer    m_FeatureImageInformation;
+
+  typedef std::pair< RegionType, LabelObjectType * > CropType;
+
+  static bool CropRegionLess( const CropType &a, const CropType &b );
+
+  void ReadFeatureImageInformation();
+
+  FeatureImagePointer ReadFeatureImageRegion( const RegionType &region );
+
+  // read region of the file into buffer, or return false when the
+  // buffer is not of the feature pixel type
+  bool ReadFeatureImageRegion( const RegionType &region, FeaturePixelType *buffer );
+
+  template< class TOtherPixel >
+  bool ReadFeatureImageRegion( const RegionType &, TOtherPixel * )
+    {
+    return false;
+    }
+
+  // read the crop bb of a single label object, by slabs along the
+  // last dimension of at most budget pixels
+  void ReadCropRegion( LabelObjectType *labelObject, const RegionType &bb, SizeValueType budget );
+
+  // read the crops of all the label objects from the file, by
+  // coalesced regions
+  void ReadCoalescedRegions();
+
 };
 
 
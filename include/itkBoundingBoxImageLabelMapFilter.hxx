@@ -19,7 +19,9 @@
 #define itkBoundingBoxImageLabelMapFilter_hxx
 
 #include "itkBoundingBoxImageLabelMapFilter.h"
-#include "itkRegionOfInterestImageFilter.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <cstring>
 
 namespace itk
 {
@@ -31,6 +33,15 @@ BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
   this->AddRequiredInputName("FeatureImage");
 
   m_PaddingOffset.Fill(0);
+
+  m_UseLabelObjectMask = false;
+  m_DefaultPixelValue = NumericTraits<AttributeImagePixelType>::ZeroValue( m_DefaultPixelValue );
+
+  m_UseFeatureImageView = false;
+  m_ArenaAllocation = false;
+
+  m_ReadMemoryBudget = 268435456;
+  m_NumberOfFeatureImageReads = 0;
 }
 
 
@@ -45,6 +56,115 @@ BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
 }
 
 
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::SetFeatureImageFileName( const std::string & fileName )
+{
+  if ( fileName == m_FeatureImageFileName )
+    {
+    return;
+    }
+  m_FeatureImageFileName = fileName;
+
+  // the FeatureImage input is only required without a file
+  if ( m_FeatureImageFileName.empty() )
+    {
+    this->AddRequiredInputName("FeatureImage");
+    }
+  else
+    {
+    this->RemoveRequiredInputName("FeatureImage");
+    }
+  this->Modified();
+}
+
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::BeforeThreadedGenerateData()
+{
+  Superclass::BeforeThreadedGenerateData();
+
+  // With a file name, only the information of the feature image is
+  // read here, the regions of the bounding boxes are read after the
+  // threads.
+  m_FeatureImageInformation = ITK_NULLPTR;
+  m_NumberOfFeatureImageReads = 0;
+  if ( !m_FeatureImageFileName.empty() )
+    {
+    if ( m_UseFeatureImageView )
+      {
+      itkExceptionMacro("UseFeatureImageView can not be used with a FeatureImageFileName");
+      }
+    this->ReadFeatureImageInformation();
+    }
+  else if ( this->GetFeatureImage() == ITK_NULLPTR )
+    {
+    itkExceptionMacro("FeatureImage or FeatureImageFileName must be set");
+    }
+
+  if ( m_UseFeatureImageView )
+    {
+    if ( !m_IntensityMapping.IsIdentity() )
+      {
+      itkExceptionMacro("UseFeatureImageView can not be used with an intensity mapping");
+      }
+    if ( m_UseLabelObjectMask )
+      {
+      itkExceptionMacro("UseFeatureImageView can not be used with UseLabelObjectMask");
+      }
+
+    const FeatureImageType *feature = this->GetFeatureImage();
+    if ( CreateFeatureImageView( feature, feature->GetBufferedRegion() ).IsNull() )
+      {
+      itkExceptionMacro("UseFeatureImageView requires the AttributeImageType to be the FeatureImageType");
+      }
+    }
+
+  // The arena is sized for the crops of all the label objects, which
+  // are written to their slice by the threads.
+  m_AttributeImageArena = ITK_NULLPTR;
+  m_ArenaOffsets.clear();
+  if ( m_ArenaAllocation && !m_UseFeatureImageView )
+    {
+    const RegionType featureRegion = m_FeatureImageInformation.IsNotNull()
+      ? m_FeatureImageInformation->GetLargestPossibleRegion()
+      : this->GetFeatureImage()->GetBufferedRegion();
+    SizeValueType arenaSize = 0;
+
+    const ImageType *output = this->GetOutput();
+    for ( typename ImageType::ConstIterator it( output ); !it.IsAtEnd(); ++it )
+      {
+      m_ArenaOffsets[it.GetLabel()] = arenaSize;
+      RegionType bb = ComputeBoundingBox( it.GetLabelObject() );
+      if ( this->ComputeCropRegion( bb, featureRegion ) )
+        {
+        arenaSize += bb.GetNumberOfPixels();
+        }
+      }
+
+    m_AttributeImageArena = AttributeImagePixelContainerType::New();
+    m_AttributeImageArena->Reserve( arenaSize );
+    }
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::AfterThreadedGenerateData()
+{
+  if ( m_FeatureImageInformation.IsNotNull() )
+    {
+    this->ReadCoalescedRegions();
+    m_FeatureImageInformation = ITK_NULLPTR;
+    }
+
+  m_ArenaOffsets.clear();
+  Superclass::AfterThreadedGenerateData();
+}
+
 template< class TImage, class TFeatureImage, class TLabelImage >
 void
 BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
@@ -52,13 +172,412 @@ BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
 {
   Superclass::ThreadedProcessLabelObject(labelObject);
 
-  bool bbOK = true;
+  // the crops are copied from the coalesced reads after the threads
+  if ( m_FeatureImageInformation.IsNotNull() )
+    {
+    return;
+    }
+
+  RegionType bb = labelObject->GetBoundingBox();
+
+  // create a shallow copy for the first image, so that the pipeline
+  // calls do not go beyond this method.
+  typename FeatureImageType::Pointer feature = FeatureImageType::New();
+  feature->Graft( this->GetFeatureImage() );
+
+  if( !this->ComputeCropRegion( bb, feature->GetBufferedRegion() ) )
+    {
+    itkExceptionMacro("Label Object: " << labelObject->GetLabel() << " has Bounding Box: "
+                      << labelObject->GetBoundingBox() << " outside of buffered region!");
+    }
+
+  if ( m_UseFeatureImageView )
+    {
+    labelObject->SetAttributeImage( CreateFeatureImageView( feature.GetPointer(), bb ) );
+    return;
+    }
 
-  typename ImageType::RegionType bb = labelObject->GetBoundingBox();
+  this->CopyCropRegion( labelObject, feature, bb );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CopyCropRegion( LabelObjectType *labelObject, const FeatureImageType *feature, const RegionType &bb ) const
+{
+  AttributeImagePointer attributeImage = this->CreateAttributeImage( labelObject, feature, bb );
+  this->CopyCropLines( labelObject, feature, bb, attributeImage );
+  labelObject->SetAttributeImage(attributeImage);
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+typename BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::AttributeImagePointer
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CreateAttributeImage( const LabelObjectType *labelObject, const FeatureImageType *feature, const RegionType &bb ) const
+{
+  // The attribute image has the geometry of the output of
+  // RegionOfInterestImageFilter, a zero start index and the origin at
+  // the start of the bounding box.
+  typename AttributeImageType::RegionType region;
+  region.SetSize( bb.GetSize() );
+
+  typename AttributeImageType::PointType origin;
+  feature->TransformIndexToPhysicalPoint( bb.GetIndex(), origin );
+
+  AttributeImagePointer attributeImage = AttributeImageType::New();
+  attributeImage->SetRegions( region );
+  attributeImage->SetOrigin( origin );
+  attributeImage->SetSpacing( feature->GetSpacing() );
+  attributeImage->SetDirection( feature->GetDirection() );
+  if ( m_AttributeImageArena.IsNotNull() )
+    {
+    const SizeValueType offset = m_ArenaOffsets.find( labelObject->GetLabel() )->second;
+    if ( offset + bb.GetNumberOfPixels() > m_AttributeImageArena->Size() )
+      {
+      itkExceptionMacro("Label Object: " << labelObject->GetLabel() << " has Bounding Box: "
+                        << labelObject->GetBoundingBox() << " larger than its slice of the arena!");
+      }
+
+    // the slice keeps the arena alive as long as the attribute image
+    typedef ArenaSliceImageContainer< AttributeImagePixelContainerType > SliceType;
+    typename SliceType::Pointer slice = SliceType::New();
+    slice->SetArenaSlice( m_AttributeImageArena, offset, bb.GetNumberOfPixels() );
+    attributeImage->SetPixelContainer( slice );
+    }
+  else
+    {
+    attributeImage->Allocate();
+    }
+
+  // only the runs of the lines of the label object are copied over
+  // the default value
+  if ( m_UseLabelObjectMask )
+    {
+    AttributeImagePixelType *output = attributeImage->GetBufferPointer();
+    std::fill( output, output + bb.GetNumberOfPixels(), m_DefaultPixelValue );
+    }
+
+  return attributeImage;
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CopyCropLines( const LabelObjectType *labelObject,
+                 const FeatureImageType *feature,
+                 const RegionType &bb,
+                 AttributeImageType *attributeImage ) const
+{
+  RegionType part = bb;
+  if ( !part.Crop( feature->GetBufferedRegion() ) )
+    {
+    return;
+    }
+
+  const FeaturePixelType  *featureBuffer = feature->GetBufferPointer();
+  AttributeImagePixelType *output = attributeImage->GetBufferPointer();
+
+  typename AttributeImageType::IndexType outputIndex;
+  if ( m_UseLabelObjectMask )
+    {
+    // only the runs of the lines of the label object inside of the
+    // part are copied
+    const SizeValueType numLines = labelObject->GetNumberOfLines();
+    for ( SizeValueType l = 0; l < numLines; ++l )
+      {
+      const typename LabelObjectType::LineType & line = labelObject->GetLine(l);
+      IndexType lineIndex = line.GetIndex();
+
+      bool inside = true;
+      for ( unsigned int j = 1; j < ImageDimension; ++j )
+        {
+        inside = inside && lineIndex[j] >= part.GetIndex(j)
+          && lineIndex[j] < part.GetIndex(j) + static_cast<IndexValueType>( part.GetSize(j) );
+        }
+      const IndexValueType begin = std::max( lineIndex[0], part.GetIndex(0) );
+      const IndexValueType end = std::min( lineIndex[0] + static_cast<IndexValueType>( line.GetLength() ),
+                                           part.GetIndex(0) + static_cast<IndexValueType>( part.GetSize(0) ) );
+      if ( !inside || begin >= end )
+        {
+        continue;
+        }
+      lineIndex[0] = begin;
+
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        outputIndex[i] = lineIndex[i] - bb.GetIndex(i);
+        }
+      this->CopyPixels( featureBuffer + feature->ComputeOffset( lineIndex ),
+                        output + attributeImage->ComputeOffset( outputIndex ), end - begin );
+      }
+    }
+  else
+    {
+    // copy the lines of the part
+    const SizeValueType lineLength = part.GetSize(0);
+    const SizeValueType numberOfLines = part.GetNumberOfPixels() / lineLength;
+
+    IndexType lineIndex = part.GetIndex();
+    for ( SizeValueType line = 0; line < numberOfLines; ++line )
+      {
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        outputIndex[i] = lineIndex[i] - bb.GetIndex(i);
+        }
+      this->CopyPixels( featureBuffer + feature->ComputeOffset( lineIndex ),
+                        output + attributeImage->ComputeOffset( outputIndex ), lineLength );
+
+      for ( unsigned int j = 1; j < ImageDimension; ++j )
+        {
+        if ( ++lineIndex[j] < part.GetIndex(j) + static_cast<IndexValueType>( part.GetSize(j) ) )
+          {
+          break;
+          }
+        lineIndex[j] = part.GetIndex(j);
+        }
+      }
+    }
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ReadFeatureImageInformation()
+{
+  if ( m_FeatureImageIO.IsNull() )
+    {
+    itkExceptionMacro("FeatureImageIO must be set with a FeatureImageFileName");
+    }
+
+  m_FeatureImageIO->SetFileName( m_FeatureImageFileName );
+  m_FeatureImageIO->ReadImageInformation();
+
+  if ( m_FeatureImageIO->GetNumberOfDimensions() != ImageDimension )
+    {
+    itkExceptionMacro("The feature image " << m_FeatureImageFileName << " has "
+                      << m_FeatureImageIO->GetNumberOfDimensions() << " dimensions, expected " << ImageDimension);
+    }
+  if ( m_FeatureImageIO->GetNumberOfComponents() != 1
+       || m_FeatureImageIO->GetComponentType() != ImageIOBase::MapPixelType<FeaturePixelType>::CType )
+    {
+    itkExceptionMacro("The pixel type " << ImageIOBase::GetComponentTypeAsString( m_FeatureImageIO->GetComponentType() )
+                      << " of the feature image " << m_FeatureImageFileName << " is not the FeatureImageType pixel type");
+    }
+  if ( !m_FeatureImageIO->CanStreamRead() )
+    {
+    itkExceptionMacro("The FeatureImageIO can not read regions of " << m_FeatureImageFileName);
+    }
+  m_FeatureImageIO->SetUseStreamedReading( true );
+
+  // the geometry of the file, as set by ImageFileReader
+  RegionType region;
+  typename FeatureImageType::SpacingType   spacing;
+  typename FeatureImageType::PointType     origin;
+  typename FeatureImageType::DirectionType direction;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    region.SetSize( i, m_FeatureImageIO->GetDimensions( i ) );
+    spacing[i] = m_FeatureImageIO->GetSpacing( i );
+    origin[i] = m_FeatureImageIO->GetOrigin( i );
+    const std::vector< double > axis = m_FeatureImageIO->GetDirection( i );
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      direction[j][i] = axis[j];
+      }
+    }
+
+  m_FeatureImageInformation = FeatureImageType::New();
+  m_FeatureImageInformation->SetLargestPossibleRegion( region );
+  m_FeatureImageInformation->SetSpacing( spacing );
+  m_FeatureImageInformation->SetOrigin( origin );
+  m_FeatureImageInformation->SetDirection( direction );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+typename BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::FeatureImagePointer
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ReadFeatureImageRegion( const RegionType &region )
+{
+  FeatureImagePointer image = FeatureImageType::New();
+  image->CopyInformation( m_FeatureImageInformation );
+  image->SetBufferedRegion( region );
+  image->Allocate();
+
+  this->ReadFeatureImageRegion( region, image->GetBufferPointer() );
+  return image;
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+bool
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ReadFeatureImageRegion( const RegionType &region, FeaturePixelType *buffer )
+{
+  ImageIORegion ioRegion( ImageDimension );
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    ioRegion.SetIndex( i, region.GetIndex( i ) );
+    ioRegion.SetSize( i, region.GetSize( i ) );
+    }
+  m_FeatureImageIO->SetIORegion( ioRegion );
+  m_FeatureImageIO->Read( buffer );
+
+  ++m_NumberOfFeatureImageReads;
+  return true;
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ReadCropRegion( LabelObjectType *labelObject, const RegionType &bb, SizeValueType budget )
+{
+  AttributeImagePointer attributeImage =
+    this->CreateAttributeImage( labelObject, m_FeatureImageInformation, bb );
+
+  // the slabs are made of whole slices of the crop, so each one is
+  // contiguous in the attribute image
+  const unsigned int  last = ImageDimension - 1;
+  const SizeValueType slicePixels = bb.GetNumberOfPixels() / bb.GetSize( last );
+  const SizeValueType slabSlices = std::max<SizeValueType>( budget / slicePixels, 1 );
+  const bool          direct = m_IntensityMapping.IsIdentity() && !m_UseLabelObjectMask;
+
+  RegionType slab = bb;
+  for ( SizeValueType slice = 0; slice < bb.GetSize( last ); slice += slabSlices )
+    {
+    slab.SetIndex( last, bb.GetIndex( last ) + static_cast<IndexValueType>( slice ) );
+    slab.SetSize( last, std::min( slabSlices, bb.GetSize( last ) - slice ) );
+
+    if ( !direct
+         || !this->ReadFeatureImageRegion( slab, attributeImage->GetBufferPointer() + slice * slicePixels ) )
+      {
+      FeatureImagePointer feature = this->ReadFeatureImageRegion( slab );
+      this->CopyCropLines( labelObject, feature, bb, attributeImage );
+      }
+    }
+
+  labelObject->SetAttributeImage( attributeImage );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+bool
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CropRegionLess( const CropType &a, const CropType &b )
+{
+  return a.first.GetIndex( ImageDimension - 1 ) < b.first.GetIndex( ImageDimension - 1 );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ReadCoalescedRegions()
+{
+  const RegionType fileRegion = m_FeatureImageInformation->GetLargestPossibleRegion();
+
+  std::vector< CropType > crops;
+  ImageType *output = this->GetOutput();
+  for ( typename ImageType::Iterator it( output ); !it.IsAtEnd(); ++it )
+    {
+    LabelObjectType *labelObject = it.GetLabelObject();
+    RegionType bb = labelObject->GetBoundingBox();
+    if ( !this->ComputeCropRegion( bb, fileRegion ) )
+      {
+      itkExceptionMacro("Label Object: " << labelObject->GetLabel() << " has Bounding Box: "
+                        << labelObject->GetBoundingBox() << " outside of the feature image!");
+      }
+    crops.push_back( CropType( bb, labelObject ) );
+    }
+
+  // Walk the crops along the last dimension, extending the current
+  // read with the next crop while the union fits in the budget and is
+  // mostly made of crops, at most twice their total size.
+  std::stable_sort( crops.begin(), crops.end(), CropRegionLess );
+
+  const SizeValueType budget = m_ReadMemoryBudget / sizeof( FeaturePixelType );
+
+  size_t first = 0;
+  while ( first < crops.size() )
+    {
+    RegionType    read = crops[first].first;
+    SizeValueType cropPixels = read.GetNumberOfPixels();
+    size_t        last = first + 1;
+    for ( ; last < crops.size(); ++last )
+      {
+      const RegionType & bb = crops[last].first;
+      IndexType lower;
+      IndexType upper;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        lower[i] = std::min( read.GetIndex(i), bb.GetIndex(i) );
+        upper[i] = std::max( read.GetUpperIndex()[i], bb.GetUpperIndex()[i] );
+        }
+      RegionType merged;
+      merged.SetIndex( lower );
+      merged.SetUpperIndex( upper );
+
+      if ( merged.GetNumberOfPixels() > budget
+           || merged.GetNumberOfPixels() > 2 * ( cropPixels + bb.GetNumberOfPixels() ) )
+        {
+        break;
+        }
+      read = merged;
+      cropPixels += bb.GetNumberOfPixels();
+      }
+
+    if ( last == first + 1 )
+      {
+      this->ReadCropRegion( crops[first].second, crops[first].first, budget );
+      }
+    else
+      {
+      FeatureImagePointer feature = this->ReadFeatureImageRegion( read );
+      for ( size_t c = first; c < last; ++c )
+        {
+        this->CopyCropRegion( crops[c].second, feature, crops[c].first );
+        }
+      }
+    first = last;
+    }
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+template< class TInputPixel >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CopyPixels( const TInputPixel *input, AttributeImagePixelType *output, SizeValueType n ) const
+{
+  for ( SizeValueType k = 0; k < n; ++k )
+    {
+    output[k] = m_IntensityMapping( static_cast<double>( input[k] ) );
+    }
+}
+
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CopyPixels( const AttributeImagePixelType *input, AttributeImagePixelType *output, SizeValueType n ) const
+{
+  if ( m_IntensityMapping.IsIdentity() )
+    {
+    std::memcpy( output, input, n * sizeof( AttributeImagePixelType ) );
+    }
+  else
+    {
+    this->CopyPixels< AttributeImagePixelType >( input, output, n );
+    }
+}
+
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+bool
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ComputeCropRegion( RegionType &bb, const RegionType &featureRegion ) const
+{
+  bool bbOK = true;
 
   for (unsigned int i = 0; i < ImageDimension; ++i)
     {
     SizeType o;
+    o.Fill(0);
     if (this->m_PaddingOffset[i] > 0 )
       {
       o[i] = this->m_PaddingOffset[i];
@@ -67,32 +586,55 @@ BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
     else if (this->m_PaddingOffset[i] < 0 &&  bb.GetSize(i) > 2)
       {
       o[i] = std::min<SizeValueType>(-this->m_PaddingOffset[i], bb.GetSize(i)/2 -1);
-      bbOK |= bb.ShrinkByRadius(o);
+      bbOK &= bb.ShrinkByRadius(o);
       assert(bbOK);
       }
     }
 
-  // create a shallow copy for the first image, so that the pipeline
-  // calls do not go beyond this method.
-  typename FeatureImageType::Pointer feature = FeatureImageType::New();
-  feature->Graft( this->GetFeatureImage() );
+  return bbOK && bb.Crop( featureRegion );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+typename BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::RegionType
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ComputeBoundingBox( const LabelObjectType *labelObject )
+{
+  IndexType minimum;
+  IndexType maximum;
+  minimum.Fill( NumericTraits<IndexValueType>::max() );
+  maximum.Fill( NumericTraits<IndexValueType>::NonpositiveMin() );
 
-  if( !bb.Crop(feature->GetBufferedRegion()) )
+  const SizeValueType numLines = labelObject->GetNumberOfLines();
+  for ( SizeValueType l = 0; l < numLines; ++l )
     {
-    itkExceptionMacro("Label Object: " << labelObject->GetLabel() << " has Bounding Box: "
-                      << labelObject->GetBoundingBox() << " outside of buffered region!");
+    const typename LabelObjectType::LineType & line = labelObject->GetLine(l);
+    const IndexType & idx = line.GetIndex();
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      minimum[i] = std::min( minimum[i], idx[i] );
+      maximum[i] = std::max( maximum[i], idx[i] );
+      }
+    maximum[0] = std::max( maximum[0], idx[0] + static_cast<IndexValueType>( line.GetLength() ) - 1 );
     }
 
-  typedef RegionOfInterestImageFilter<FeatureImageType, AttributeImageType> ROIFilterType;
-  typename ROIFilterType::Pointer roi = ROIFilterType::New();
-
-  roi->SetInput(feature);
-  roi->SetRegionOfInterest( bb );
-  roi->SetNumberOfThreads(1);
-  roi->UpdateLargestPossibleRegion();
-
-  labelObject->SetAttributeImage(roi->GetOutput());
+  RegionType region;
+  region.SetIndex( minimum );
+  region.SetUpperIndex( maximum );
+  return region;
+}
 
+template< class TImage, class TFeatureImage, class TLabelImage >
+typename BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::AttributeImagePointer
+BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CreateFeatureImageView( const AttributeImageType *feature, const RegionType &region )
+{
+  AttributeImagePointer view = AttributeImageType::New();
+  view->CopyInformation( feature );
+  view->SetLargestPossibleRegion( region );
+  view->SetBufferedRegion( feature->GetBufferedRegion() );
+  view->SetRequestedRegion( region );
+  view->SetPixelContainer( const_cast<typename AttributeImageType::PixelContainer *>( feature->GetPixelContainer() ) );
+  return view;
 }
 
 template< class TImage, class TFeatureImage, class TLabelImage  >
@@ -101,7 +643,18 @@ BoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
 ::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
-  std::cout << indent << "PaddingOffset: " << m_PaddingOffset;
+  os << indent << "PaddingOffset: " << m_PaddingOffset << std::endl;
+  m_IntensityMapping.Print(os, indent);
+  os << indent << "UseLabelObjectMask: " << m_UseLabelObjectMask << std::endl;
+  os << indent << "DefaultPixelValue: "
+     << static_cast<typename NumericTraits<AttributeImagePixelType>::PrintType>( m_DefaultPixelValue ) << std::endl;
+  os << indent << "UseFeatureImageView: " << m_UseFeatureImageView << std::endl;
+  os << indent << "ArenaAllocation: " << m_ArenaAllocation << std::endl;
+  os << indent << "FeatureImageFileName: " << m_FeatureImageFileName << std::endl;
+  os << indent << "FeatureImageIO: " << m_FeatureImageIO.GetPointer() << std::endl;
+  os << indent << "ReadMemoryBudget: " << m_ReadMemoryBudget << std::endl;
+  os << indent << "NumberOfFeatureImageReads: " << m_NumberOfFeatureImageReads << std::endl;
+  os << indent << "AttributeImageArena: " << m_AttributeImageArena.GetPointer() << std::endl;
 }
 
 } // end namespace itk
@@ -23,6 +23,7 @@
 #include "itkDenseFrequencyContainer2.h"
 
 #include "itkInPlaceLabelMapFilter.h"
+#include "itkScheduledLabelMapFilter.h"
 
 namespace itk
 {
@@ -50,14 +51,14 @@ template< class TImage,
           typename TFeatureImage,
           class TSuperclass = InPlaceLabelMapFilter<TImage> >
 class GLCMLabelMapFilter:
-  public TSuperclass
+  public ScheduledLabelMapFilter< TSuperclass >
 {
 public:
   /** Standard class typedefs. */
-  typedef GLCMLabelMapFilter                Self;
-  typedef TSuperclass                       Superclass;
-  typedef SmartPointer< Self >              Pointer;
-  typedef SmartPointer< const Self >        ConstPointer;
+  typedef GLCMLabelMapFilter                      Self;
+  typedef ScheduledLabelMapFilter< TSuperclass >  Superclass;
+  typedef SmartPointer< Self >                    Pointer;
+  typedef SmartPointer< const Self >              ConstPointer;
 
   /** Some convenient typedefs. */
   typedef TImage                               ImageType;
@@ -69,6 +70,8 @@ public:
   typedef typename ImageType::RegionType       RegionType;
   typedef typename ImageType::LabelObjectType  LabelObjectType;
 
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+
   typedef TFeatureImage                           FeatureImageType;
   typedef typename FeatureImageType::Pointer      FeatureImagePointer;
   typedef typename FeatureImageType::ConstPointer FeatureImageConstPointer;
@@ -94,7 +97,7 @@ public:
   itkNewMacro(Self);
 
   /** Runtime information support. */
-  itkTypeMacro(GLCMLabelMapFilter, TSuperclass);
+  itkTypeMacro(GLCMLabelMapFilter, ScheduledLabelMapFilter);
 
   /** Set the feature image used to compute the GLCM. */
   void SetFeatureImage(const TFeatureImage *input)
@@ -0,0 +1,146 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkLabelObjectLineLookup_h
+#define itkLabelObjectLineLookup_h
+
+#include "itkIndex.h"
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+/** \class LabelObjectLineLookup
+ * \brief Test if an index is in a label object with a binary search of
+ * its RLE lines.
+ *
+ * The lines of the label object are copied, sorted by row then by the
+ * start of the line, and the overlapping or adjacent lines of a row
+ * are merged, so the lines of a label object do not need to be
+ * optimized. The lookup costs O(log(number of lines)) and is thread
+ * safe once initialized.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+template< class TLabelObject >
+class LabelObjectLineLookup
+{
+public:
+  typedef TLabelObject                         LabelObjectType;
+  typedef typename LabelObjectType::LineType   LineType;
+  typedef typename LabelObjectType::IndexType  IndexType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, LabelObjectType::ImageDimension);
+
+  void Initialize( const LabelObjectType *labelObject )
+  {
+    const SizeValueType numLines = labelObject->GetNumberOfLines();
+
+    m_Lines.clear();
+    m_Lines.reserve( numLines );
+    for( SizeValueType l = 0; l < numLines; ++l )
+      {
+      m_Lines.push_back( labelObject->GetLine(l) );
+      }
+    std::sort( m_Lines.begin(), m_Lines.end(), LineCompare() );
+
+    // merge the lines overlapping the previous line of their row, so
+    // the last line starting at or before an index is the only one
+    // which may contain it
+    typename LineContainerType::iterator last = m_Lines.begin();
+    for ( typename LineContainerType::iterator it = m_Lines.begin(); it != m_Lines.end(); ++it )
+      {
+      if ( it != last && SameRow( last->GetIndex(), it->GetIndex() )
+           && it->GetIndex()[0] <= last->GetIndex()[0] + static_cast<IndexValueType>( last->GetLength() ) )
+        {
+        const IndexValueType end = std::max( last->GetIndex()[0] + static_cast<IndexValueType>( last->GetLength() ),
+                                             it->GetIndex()[0] + static_cast<IndexValueType>( it->GetLength() ) );
+        last->SetLength( end - last->GetIndex()[0] );
+        }
+      else if ( it != last )
+        {
+        *++last = *it;
+        }
+      }
+    if ( !m_Lines.empty() )
+      {
+      m_Lines.erase( ++last, m_Lines.end() );
+      }
+  }
+
+  bool IsInside( const IndexType &idx ) const
+  {
+    // the last line starting at or before the index
+    typename LineContainerType::const_iterator it =
+      std::upper_bound( m_Lines.begin(), m_Lines.end(), idx, LineCompare() );
+    if ( it == m_Lines.begin() )
+      {
+      return false;
+      }
+    --it;
+
+    const IndexType & start = it->GetIndex();
+    return SameRow( start, idx ) && idx[0] < start[0] + static_cast<IndexValueType>( it->GetLength() );
+  }
+
+private:
+  typedef std::vector<LineType> LineContainerType;
+
+  static bool SameRow( const IndexType &a, const IndexType &b )
+  {
+    for ( unsigned int i = 1; i < ImageDimension; ++i )
+      {
+      if ( a[i] != b[i] )
+        {
+        return false;
+        }
+      }
+    return true;
+  }
+
+  struct LineCompare
+  {
+    static bool Less( const IndexType &a, const IndexType &b )
+    {
+      for ( unsigned int i = ImageDimension - 1; i > 0; --i )
+        {
+        if ( a[i] != b[i] )
+          {
+          return a[i] < b[i];
+          }
+        }
+      return a[0] < b[0];
+    }
+
+    bool operator()( const LineType &a, const LineType &b ) const
+    {
+      return Less( a.GetIndex(), b.GetIndex() );
+    }
+
+    bool operator()( const IndexType &a, const LineType &b ) const
+    {
+      return Less( a, b.GetIndex() );
+    }
+  };
+
+  LineContainerType m_Lines;
+};
+
+} // end namespace itk
+
+#endif
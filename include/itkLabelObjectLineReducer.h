@@ -0,0 +1,139 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkLabelObjectLineReducer_h
+#define itkLabelObjectLineReducer_h
+
+#include "itkLabelObjectScheduler.h"
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+/** \class LabelObjectLineReducer
+ * \brief Reduce the RLE lines of a single label object in parallel.
+ *
+ * The lines of the label object are partitioned into contiguous
+ * chunks, LabelObjectScheduler::ChunksPerThread per thread, which
+ * are processed with LabelObjectScheduler::ProcessChunks by the
+ * calling thread and the idle threads of the filter. Each chunk is
+ * reduced into its own copy of the accumulator, and the partial
+ * results are then merged in chunk order, so the result does not
+ * depend on the threads which processed the chunks.
+ *
+ * With a stride greater than one, only the lines 0, stride,
+ * 2*stride, ... and the last line are reduced, the others are not
+ * visited at all.
+ *
+ * The accumulator must be copy constructible, provide
+ * "void operator()( const LineType & )" to add a line, and
+ * "void Merge( const TAccumulator & )" to combine a partial
+ * result. The accumulator passed to Reduce must be in its initial,
+ * empty state as it is used as the prototype for each chunk.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+template< class TLabelObject, class TAccumulator >
+class LabelObjectLineReducer
+{
+public:
+  typedef TLabelObject                         LabelObjectType;
+  typedef TAccumulator                         AccumulatorType;
+  typedef typename LabelObjectType::LineType   LineType;
+  typedef LabelObjectScheduler< TLabelObject > SchedulerType;
+
+  /** Reduce every stride-th line of labelObject, and the last one,
+   * into accumulator. The lines are reduced in the calling thread
+   * when numberOfThreads is 1 or scheduler is NULL. */
+  static void Reduce( const LabelObjectType *labelObject,
+                      AccumulatorType &accumulator,
+                      SchedulerType *scheduler,
+                      ThreadIdType numberOfThreads,
+                      SizeValueType stride = 1 )
+  {
+    const SizeValueType numLines = labelObject->GetNumberOfLines();
+    if ( numLines == 0 )
+      {
+      return;
+      }
+    stride = std::max<SizeValueType>( stride, 1 );
+
+    // the j-th reduced line is min(j*stride, numLines-1)
+    const SizeValueType numReduced = ( numLines - 1 + stride - 1 ) / stride + 1;
+
+    if ( scheduler == NULL || numberOfThreads <= 1 || numReduced < 2 )
+      {
+      for( SizeValueType j = 0; j < numReduced; ++j )
+        {
+        accumulator( labelObject->GetLine( std::min( j * stride, numLines - 1 ) ) );
+        }
+      return;
+      }
+
+    const SizeValueType numberOfChunks =
+      std::min<SizeValueType>( numberOfThreads * SchedulerType::ChunksPerThread, numReduced );
+
+    ChunkedReduction reduction( labelObject, accumulator, numberOfChunks, stride, numReduced );
+    scheduler->ProcessChunks( reduction, numberOfChunks );
+
+    for( SizeValueType c = 0; c < numberOfChunks; ++c )
+      {
+      accumulator.Merge( reduction.m_Partials[c] );
+      }
+  }
+
+private:
+  class ChunkedReduction:
+    public SchedulerType::ChunkedWork
+  {
+  public:
+    ChunkedReduction( const LabelObjectType *labelObject,
+                      const AccumulatorType &prototype,
+                      SizeValueType numberOfChunks,
+                      SizeValueType stride,
+                      SizeValueType numReduced )
+      : m_LabelObject( labelObject ),
+        m_Stride( stride ),
+        m_NumberOfReducedLines( numReduced ),
+        m_Partials( numberOfChunks, prototype )
+    {}
+
+    virtual void ProcessChunk( SizeValueType chunk ) ITK_OVERRIDE
+    {
+      const SizeValueType lastLine = m_LabelObject->GetNumberOfLines() - 1;
+      const SizeValueType numberOfChunks = m_Partials.size();
+      const SizeValueType begin = ( m_NumberOfReducedLines * chunk ) / numberOfChunks;
+      const SizeValueType end = ( m_NumberOfReducedLines * ( chunk + 1 ) ) / numberOfChunks;
+
+      AccumulatorType &partial = m_Partials[chunk];
+      for( SizeValueType j = begin; j < end; ++j )
+        {
+        partial( m_LabelObject->GetLine( std::min( j * m_Stride, lastLine ) ) );
+        }
+    }
+
+    const LabelObjectType         *m_LabelObject;
+    SizeValueType                  m_Stride;
+    SizeValueType                  m_NumberOfReducedLines;
+    std::vector<AccumulatorType>   m_Partials;
+  };
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,343 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkLabelObjectScheduler_h
+#define itkLabelObjectScheduler_h
+
+#include "itkProcessObject.h"
+#include "itkSimpleMutexLock.h"
+#include "itkConditionVariable.h"
+#include "itkMutexLockHolder.h"
+#include <algorithm>
+#include <list>
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+
+/** \class LabelObjectScheduler
+ * \brief Hands out the label objects of a label map to threads,
+ * largest first.
+ *
+ * The estimated cost of a label object is its number of RLE
+ * lines. When cost ordering is enabled the objects are sorted by
+ * decreasing cost, otherwise they are handed out in label order. The
+ * objects are kept in a single shared queue and each thread takes
+ * the next object as soon as it is idle, so that a large object is
+ * started early instead of being left for the end.
+ *
+ * The processing of a single large object can be split into chunks
+ * with ProcessChunks. The chunks are processed by the thread of the
+ * object, and by the threads which have run out of label objects:
+ * GetNextLabelObject does not return NULL while an object is still
+ * processed, it processes its chunks instead. So the total number of
+ * threads never exceeds the number of threads of the filter, and no
+ * thread is created for an object.
+ *
+ * This replaces the label order iteration of LabelMapFilter for the
+ * filters of this module, see ScheduledLabelMapFilter. Each call to
+ * GetNextLabelObject also reports progress. Only the intermediate
+ * progress is reported: the start and the end of the update are
+ * already reported by LabelMapFilter.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+template< class TLabelObject >
+class LabelObjectScheduler
+{
+public:
+  typedef TLabelObject LabelObjectType;
+
+  /** \class ChunkedWork
+   * \brief Interface of the work passed to ProcessChunks.
+   *
+   * ProcessChunk is called once for each chunk, concurrently from
+   * several threads.
+   * \ingroup ITKOBBLabelMap
+   */
+  class ChunkedWork
+  {
+  public:
+    virtual void ProcessChunk( SizeValueType chunk ) = 0;
+
+  protected:
+    virtual ~ChunkedWork() {}
+  };
+
+  /** A number of chunks for each thread, so that the threads becoming
+   * idle while an object is processed still find chunks to process. */
+  itkStaticConstMacro(ChunksPerThread, unsigned int, 4);
+
+  LabelObjectScheduler()
+    : m_Next( 0 ),
+      m_ProgressInterval( 1 ),
+      m_Filter( NULL ),
+      m_NumberOfLabelObjectsInProgress( 0 ),
+      m_Condition( ConditionVariable::New() )
+  {}
+
+  ~LabelObjectScheduler()
+  {
+    this->Clear();
+  }
+
+  /** Fill the queue with the label objects of the label map. This
+   * method is not thread safe and is expected to be called from
+   * BeforeThreadedGenerateData. */
+  template< class TLabelMap >
+  void Initialize( ProcessObject *filter, TLabelMap *labelMap, bool costOrdered )
+  {
+    this->Clear();
+
+    m_Queue.reserve( labelMap->GetNumberOfLabelObjects() );
+
+    typename TLabelMap::Iterator it( labelMap );
+    while( !it.IsAtEnd() )
+      {
+      LabelObjectType *labelObject = it.GetLabelObject();
+      m_Queue.push_back( QueueEntryType( labelObject->GetNumberOfLines(), labelObject ) );
+      ++it;
+      }
+
+    if ( costOrdered )
+      {
+      // stable so that objects of equal cost stay in label order
+      std::stable_sort( m_Queue.begin(), m_Queue.end(), GreaterCost() );
+      }
+
+    // about 100 updates, as with ProgressReporter
+    m_ProgressInterval = std::max<size_t>( m_Queue.size() / 100, 1 );
+    m_Filter = filter;
+  }
+
+  /** Returns the next label object to process, or NULL when all
+   * label objects have been processed. Once the queue is empty, the
+   * calling thread processes the chunks of the objects still
+   * processed by other threads until they are completed. Each label
+   * object returned must be passed to CompletedLabelObject once
+   * processed. This method is thread safe. */
+  LabelObjectType * GetNextLabelObject()
+  {
+    MutexLockHolder<SimpleMutexLock> lock( m_Mutex );
+
+    while ( m_Next >= m_Queue.size() )
+      {
+      PostedWorkType *posted = this->GetPostedWork();
+      if ( posted != NULL )
+        {
+        this->ProcessPostedChunk( posted );
+        }
+      else if ( m_NumberOfLabelObjectsInProgress == 0 )
+        {
+        return NULL;
+        }
+      else
+        {
+        m_Condition->Wait( &m_Mutex );
+        }
+      }
+
+    // pretend the object is processed, even if it will be done
+    // later, to simplify the lock management
+    if ( m_Next != 0 && m_Next % m_ProgressInterval == 0 )
+      {
+      m_Filter->UpdateProgress( static_cast<float>( m_Next ) / m_Queue.size() );
+      if ( m_Filter->GetAbortGenerateData() )
+        {
+        ProcessAborted e(__FILE__, __LINE__);
+        e.SetDescription("Process aborted.");
+        e.SetLocation(ITK_LOCATION);
+        throw e;
+        }
+      }
+
+    ++m_NumberOfLabelObjectsInProgress;
+    return m_Queue[m_Next++].second;
+  }
+
+  /** Notify that a label object returned by GetNextLabelObject has
+   * been processed, or has failed. This method is thread safe. */
+  void CompletedLabelObject()
+  {
+    MutexLockHolder<SimpleMutexLock> lock( m_Mutex );
+
+    if ( --m_NumberOfLabelObjectsInProgress == 0 )
+      {
+      // release the threads waiting for chunks
+      m_Condition->Broadcast();
+      }
+  }
+
+  /** Process the chunks [0,numberOfChunks) of work, in the calling
+   * thread and in the idle threads, and return when all of them are
+   * processed. When a chunk throws an exception, the chunks not
+   * started are skipped and the exception is thrown again in the
+   * calling thread, as an ExceptionObject. This method is thread
+   * safe, and may be called when the queue is not initialized, in
+   * which case the calling thread processes all the chunks. */
+  void ProcessChunks( ChunkedWork &work, SizeValueType numberOfChunks )
+  {
+    if ( numberOfChunks == 0 )
+      {
+      return;
+      }
+
+    PostedWorkType posted;
+    posted.Work = &work;
+    posted.NumberOfChunks = numberOfChunks;
+    posted.NextChunk = 0;
+    posted.NumberOfPendingChunks = numberOfChunks;
+    posted.Failed = false;
+
+    MutexLockHolder<SimpleMutexLock> lock( m_Mutex );
+
+    m_PostedWork.push_back( &posted );
+    m_Condition->Broadcast();
+
+    while ( posted.NextChunk < posted.NumberOfChunks )
+      {
+      this->ProcessPostedChunk( &posted );
+      }
+
+    // the chunks started by other threads still use the work
+    while ( posted.NumberOfPendingChunks != 0 )
+      {
+      m_Condition->Wait( &m_Mutex );
+      }
+    m_PostedWork.remove( &posted );
+
+    if ( posted.Failed )
+      {
+      throw posted.Exception;
+      }
+  }
+
+  /** Release the queue. */
+  void Clear()
+  {
+    m_Queue.clear();
+    m_Next = 0;
+    m_Filter = NULL;
+    m_NumberOfLabelObjectsInProgress = 0;
+  }
+
+private:
+  LabelObjectScheduler(const LabelObjectScheduler &); //purposely not implemented
+  void operator=(const LabelObjectScheduler &);       //purposely not implemented
+
+  typedef std::pair< SizeValueType, LabelObjectType * > QueueEntryType;
+
+  struct GreaterCost
+  {
+    bool operator()( const QueueEntryType &a, const QueueEntryType &b ) const
+    {
+      return a.first > b.first;
+    }
+  };
+
+  struct PostedWorkType
+  {
+    ChunkedWork     *Work;
+    SizeValueType    NumberOfChunks;
+    SizeValueType    NextChunk;
+    SizeValueType    NumberOfPendingChunks;
+    bool             Failed;
+    ExceptionObject  Exception;
+  };
+
+  // the first posted work with a chunk not started, called with the
+  // lock held
+  PostedWorkType * GetPostedWork() const
+  {
+    for ( typename std::list< PostedWorkType * >::const_iterator it = m_PostedWork.begin();
+          it != m_PostedWork.end(); ++it )
+      {
+      if ( ( *it )->NextChunk < ( *it )->NumberOfChunks )
+        {
+        return *it;
+        }
+      }
+    return NULL;
+  }
+
+  // process the next chunk of posted, called with the lock held which
+  // is released during the processing. The exceptions are kept for
+  // the thread which posted the work.
+  void ProcessPostedChunk( PostedWorkType *posted )
+  {
+    const SizeValueType chunk = posted->NextChunk++;
+
+    m_Mutex.Unlock();
+    bool failed = true;
+    ExceptionObject exception;
+    try
+      {
+      posted->Work->ProcessChunk( chunk );
+      failed = false;
+      }
+    catch ( ExceptionObject & e )
+      {
+      exception = e;
+      }
+    catch ( std::exception & e )
+      {
+      exception = ExceptionObject( __FILE__, __LINE__, e.what(), ITK_LOCATION );
+      }
+    catch ( ... )
+      {
+      exception = ExceptionObject( __FILE__, __LINE__, "Unknown exception", ITK_LOCATION );
+      }
+    m_Mutex.Lock();
+
+    if ( failed )
+      {
+      this->FailedChunk( posted, exception );
+      }
+    if ( --posted->NumberOfPendingChunks == 0 )
+      {
+      m_Condition->Broadcast();
+      }
+  }
+
+  // skip the chunks not started
+  void FailedChunk( PostedWorkType *posted, const ExceptionObject &e )
+  {
+    if ( !posted->Failed )
+      {
+      posted->Failed = true;
+      posted->Exception = e;
+      }
+    posted->NumberOfPendingChunks -= posted->NumberOfChunks - posted->NextChunk;
+    posted->NextChunk = posted->NumberOfChunks;
+  }
+
+  std::vector< QueueEntryType > m_Queue;
+  size_t                        m_Next;
+  size_t                        m_ProgressInterval;
+  ProcessObject                *m_Filter;
+
+  SizeValueType                 m_NumberOfLabelObjectsInProgress;
+  std::list< PostedWorkType * > m_PostedWork;
+
+  SimpleMutexLock               m_Mutex;
+  ConditionVariable::Pointer    m_Condition;
+};
+
+} // end namespace itk
+
+#endif
@@ -21,12 +21,91 @@
 #include "itkInPlaceLabelMapFilter.h"
 #include "itkOrientedBoundingBoxLabelMapFilter.h"
 #include "itkInterpolateImageFunction.h"
+#include "itkLabelObjectLineLookup.h"
+#include "itkAttributeIntensityMapping.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+#include <algorithm>
+#include <map>
+#include <vector>
 
 namespace itk
 {
 
 /** \class OrientedBoundingBoxImageLabelMapFilter
-
+ * \brief Resamples the feature image onto the oriented bounding box
+ * of each label object.
+ *
+ * The attribute image of each label object is aligned with the
+ * oriented bounding box and sampled with the AttributeImageSpacing.
+ * The map from the attribute image index to the continuous index of
+ * the feature image is affine, so it is computed once per label
+ * object and the output scanlines are walked with a constant
+ * increment, writing directly into the attribute image buffer. Points
+ * outside of the feature image are set to the DefaultPixelValue, and
+ * the interpolated values are clamped to the range of the attribute
+ * pixel type as done by ResampleImageFilter.
+ *
+ * The interpolated value v is stored as (v+Shift)*Scale clamped to
+ * [OutputMinimum,OutputMaximum], so the samples can be normalized or
+ * windowed into a narrow attribute pixel type while they are written,
+ * instead of rescaling the attribute images afterwards.
+ *
+ * With UseLabelObjectMask, only the pixels whose nearest label map
+ * index is in the label object are interpolated, which avoids the
+ * empty corners of the box for thin and oblique objects. The
+ * membership is tested against the RLE lines of the label object. The
+ * mask itself can be stored in the label objects with
+ * GenerateMaskImage.
+ *
+ * The attribute image of a label object with at least
+ * LargeAttributeImageNumberOfPixels pixels is split into slabs along
+ * the last dimension, which are resampled by the thread of the object
+ * and by the threads which have run out of label objects.
+ *
+ * The attribute image is traversed by bricks, sized so that the
+ * region of the feature images read by a brick fits in
+ * TraversalCacheSize bytes. When the box is oblique to the feature
+ * image, the raster order of the attribute image jumps across the
+ * rows and slices of the feature image, while a brick keeps reading
+ * the same cache lines.
+ *
+ * Several co-registered feature images can be resampled in the same
+ * pass with SetNthFeatureImage, the n-th one giving the n-th attribute
+ * image of the label objects. The map to the continuous index is
+ * computed once per output pixel for the feature images sharing the
+ * same geometry, and with the default linear interpolator the
+ * interpolation weights are shared as well when all the feature images
+ * have the same geometry.
+ *
+ * With a non zero BatchPatchSize, the feature image of every label
+ * object is resampled onto a grid of BatchPatchSize pixels spanning
+ * its padded oriented bounding box, and written directly into the slot
+ * of the label object in the BatchImage, an image with one more
+ * dimension whose last index is the slot. No attribute image is
+ * allocated for the label objects in this mode. The spacing of the
+ * patch of a label object along the i-th axis of the box is
+ * (OrientedBoundingBoxSize[i]+2*PaddingOffset[i])/(BatchPatchSize[i]-1),
+ * and its origin and direction are those of the attribute image. When
+ * the padded box is flat along the i-th axis, or BatchPatchSize[i] is
+ * 1, the spacing is AttributeImageSpacing[i] instead, and the patch is
+ * centered on the box along this axis.
+ *
+ * With PrincipalPlanes, only the cross sections of the box through the
+ * centroid of the label object are resampled, one normal to each axis
+ * of the box. The k-th slice is an attribute image with a single pixel
+ * along the k-th axis, on the grid of the full attribute image
+ * otherwise, and is stored as the k-th attribute image of the label
+ * object. With several feature images, the slices of the f-th feature
+ * image are the attribute images f*ImageDimension+k.
+ *
+ * With a Projection, the samples along the ProjectionAxis-th axis of
+ * the box are accumulated while resampling, and only the projected
+ * attribute image, with a single pixel along this axis, is allocated.
+ * The samples outside of the feature image, or outside of the label
+ * object with UseLabelObjectMask, are not accumulated, and a projected
+ * pixel without samples is set to the DefaultPixelValue.
+ *
  * \ingroup ITKLabelMap
  * \ingroup ITKOBBLabelMap
  */
@@ -52,16 +131,40 @@ public:
   typedef typename ImageType::IndexType        IndexType;
   typedef typename ImageType::SizeType         SizeType;
   typedef typename ImageType::LabelObjectType  LabelObjectType;
+  typedef typename LabelObjectType::LabelType  LabelType;
 
   typedef typename ImageType::SpacingType      SpacingType;
 
   typedef TFeatureImage                                FeatureImageType;
   typedef typename LabelObjectType::AttributeImageType AttributeImageType;
   typedef typename AttributeImageType::PixelType       AttributeImagePixelType;
+  typedef typename AttributeImageType::RegionType      AttributeImageRegionType;
+  typedef typename LabelObjectType::MaskImageType      MaskImageType;
+
+  typedef LabelObjectLineLookup< LabelObjectType >     LineLookupType;
+  typedef typename Superclass::LabelObjectSchedulerType LabelObjectSchedulerType;
+
+  /** The patches of the batch mode, the last index is the slot of the
+   * label object. */
+  typedef Image< AttributeImagePixelType, TImage::ImageDimension + 1 >             BatchImageType;
+  typedef Image< typename MaskImageType::PixelType, TImage::ImageDimension + 1 >   BatchMaskImageType;
+  typedef std::vector< LabelType >                                                 BatchLabelArrayType;
+
+  /** The accumulation of the samples along the projection axis. */
+  typedef enum {
+    NoProjection = 0,
+    MaximumProjection,
+    MinimumProjection,
+    MeanProjection,
+    SumProjection
+  } ProjectionType;
 
   /** Interpolator typedef. */
   typedef InterpolateImageFunction< FeatureImageType, double >     InterpolatorType;
 
+  typedef std::vector< typename InterpolatorType::Pointer >   InterpolatorArrayType;
+  typedef std::vector< typename AttributeImageType::Pointer > AttributeImageArrayType;
+
   /** ImageDimension constants */
   itkStaticConstMacro(ImageDimension, unsigned int, TImage::ImageDimension);
 
@@ -74,6 +177,16 @@ public:
   itkSetInputMacro(FeatureImage, FeatureImageType)
   itkGetInputMacro(FeatureImage, FeatureImageType)
 
+  /** Set/Get the idx-th feature image, the 0-th is the
+   * FeatureImage. The idx-th feature image is resampled into the
+   * idx-th attribute image of the label objects. */
+  void SetNthFeatureImage( unsigned int idx, const FeatureImageType *image );
+  const FeatureImageType * GetNthFeatureImage( unsigned int idx ) const;
+
+  /** Get the number of feature images set, up to the first one not
+   * set. */
+  unsigned int GetNumberOfFeatureImages() const;
+
   /** Specifies an additional amount to grow or shrink the bounding
    * box by when extracting to the output image, physical
    * size. Positive numbers expand the image, while negative shrink.
@@ -90,7 +203,9 @@ public:
   /** Get/Set the interpolator function use to resample the feature
    * image. The default is LinearInterpolateImageFunction.
    *
-   * \note Currently the parameter is ignored due to a threading issue.
+   * The interpolator is not used directly, it is cloned for each
+   * thread when the filter is executed. Parameters which are not
+   * copied by Clone() are not used.
   */
   itkSetObjectMacro(Interpolator, InterpolatorType);
   itkGetModifiableObjectMacro(Interpolator, InterpolatorType);
@@ -100,6 +215,36 @@ public:
   itkSetMacro(DefaultPixelValue, AttributeImagePixelType);
   itkGetConstReferenceMacro(DefaultPixelValue, AttributeImagePixelType);
 
+  typedef Functor::AttributeIntensityMapping< AttributeImagePixelType > IntensityMappingType;
+
+  /** Set/Get the linear mapping of the interpolated values,
+   * (v+Shift)*Scale as with ShiftScaleImageFilter. The
+   * DefaultPixelValue is not mapped.
+   *
+   * Defaults to 0 and 1.
+   **/
+  void SetShift( double shift ) { if ( m_IntensityMapping.SetShift( shift ) ) { this->Modified(); } }
+  double GetShift() const { return m_IntensityMapping.GetShift(); }
+  void SetScale( double scale ) { if ( m_IntensityMapping.SetScale( scale ) ) { this->Modified(); } }
+  double GetScale() const { return m_IntensityMapping.GetScale(); }
+
+  /** Set/Get the range the mapped values are clamped to.
+   *
+   * Defaults to the range of the attribute pixel type.
+   **/
+  void SetOutputMinimum( AttributeImagePixelType minimum )
+    { if ( m_IntensityMapping.SetOutputMinimum( minimum ) ) { this->Modified(); } }
+  AttributeImagePixelType GetOutputMinimum() const { return m_IntensityMapping.GetOutputMinimum(); }
+  void SetOutputMaximum( AttributeImagePixelType maximum )
+    { if ( m_IntensityMapping.SetOutputMaximum( maximum ) ) { this->Modified(); } }
+  AttributeImagePixelType GetOutputMaximum() const { return m_IntensityMapping.GetOutputMaximum(); }
+
+  /** Set the Shift and Scale so that the window of feature values is
+   * mapped onto [OutputMinimum,OutputMaximum], as
+   * IntensityWindowingImageFilter does. The output range must be set
+   * before. */
+  void SetIntensityWindow( double windowMinimum, double windowMaximum )
+    { if ( m_IntensityMapping.SetIntensityWindow( windowMinimum, windowMaximum ) ) { this->Modified(); } }
 
   /** Specifies that spacing used to resample the attribute image
    * onto.
@@ -109,6 +254,90 @@ public:
   itkSetMacro(AttributeImageSpacing, SpacingType);
   itkGetConstMacro(AttributeImageSpacing, SpacingType);
 
+  /** Set/Get whether only the pixels of the attribute image inside of
+   * the label object are interpolated. A pixel is inside when the
+   * nearest index of the label map is in the label object, the other
+   * pixels are set to the DefaultPixelValue.
+   *
+   * Defaults to false.
+   **/
+  itkSetMacro(UseLabelObjectMask, bool);
+  itkGetConstMacro(UseLabelObjectMask, bool);
+  itkBooleanMacro(UseLabelObjectMask);
+
+  /** Set/Get whether the label object resampled onto the grid of the
+   * attribute image is stored as the MaskImage of the label objects.
+   *
+   * Defaults to false.
+   **/
+  itkSetMacro(GenerateMaskImage, bool);
+  itkGetConstMacro(GenerateMaskImage, bool);
+  itkBooleanMacro(GenerateMaskImage);
+
+  /** Set/Get the number of pixels at which the attribute image of a
+   * single label object is split into slabs shared with the idle
+   * threads. Zero disables the splitting. Defaults to 262144.
+   */
+  itkSetMacro(LargeAttributeImageNumberOfPixels, SizeValueType);
+  itkGetConstMacro(LargeAttributeImageNumberOfPixels, SizeValueType);
+
+  /** Set/Get the number of bytes of the feature images which the
+   * bricks of the attribute image traversal may read, about the size
+   * of the L2 cache. Zero traverses the attribute image in raster
+   * order. Defaults to 262144.
+   */
+  itkSetMacro(TraversalCacheSize, SizeValueType);
+  itkGetConstMacro(TraversalCacheSize, SizeValueType);
+
+  /** Set/Get whether only the principal plane slices through the
+   * centroid are resampled, instead of the whole box. The mask image
+   * is not generated in this mode, and it can not be used with the
+   * batch mode.
+   *
+   * Defaults to false.
+   **/
+  itkSetMacro(PrincipalPlanes, bool);
+  itkGetConstMacro(PrincipalPlanes, bool);
+  itkBooleanMacro(PrincipalPlanes);
+
+  /** Set/Get the accumulation of the projection mode. NoProjection
+   * resamples the whole box. The mask image is not generated with a
+   * projection, and it can not be used with the batch mode or the
+   * principal planes.
+   *
+   * Defaults to NoProjection.
+   **/
+  itkSetMacro(Projection, ProjectionType);
+  itkGetConstMacro(Projection, ProjectionType);
+
+  /** Set/Get the axis of the box along which the samples are
+   * projected.
+   *
+   * Defaults to 0.
+   **/
+  itkSetMacro(ProjectionAxis, unsigned int);
+  itkGetConstMacro(ProjectionAxis, unsigned int);
+
+  /** Set/Get the size of the patches of the batch mode. The batch mode
+   * is used when all the components are non zero.
+   *
+   * Defaults to zero.
+   **/
+  itkSetMacro(BatchPatchSize, SizeType);
+  itkGetConstReferenceMacro(BatchPatchSize, SizeType);
+
+  /** Get the batch of patches resampled from the idx-th feature image,
+   * NULL when the batch mode is not used. */
+  BatchImageType * GetBatchImage( unsigned int idx = 0 );
+
+  /** Get the batch of the label objects resampled onto the patches,
+   * with GenerateMaskImage. */
+  itkGetModifiableObjectMacro(BatchMaskImage, BatchMaskImageType);
+
+  /** Get the label of the label object of each slot of the batch. The
+   * slots follow the order of the labels in the label map. */
+  itkGetConstReferenceMacro(BatchLabels, BatchLabelArrayType);
+
   // NOTE: This is not the best thing to do. We only want to ignore
   // the geometry of the spacing image, not all of them. So if another
   // filter has this as a requirement it may be wrong... but such a
@@ -118,8 +347,114 @@ public:
 protected:
   OrientedBoundingBoxImageLabelMapFilter();
 
+  virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  virtual void AfterThreadedGenerateData() ITK_OVERRIDE;
+
   virtual void ThreadedProcessLabelObject(LabelObjectType *labelObject) ITK_OVERRIDE;
 
+  /** Take the interpolators bound to the feature images for exclusive
+   * use, and give them back when done. The clones of the Interpolator
+   * made in BeforeThreadedGenerateData, one set per thread, are
+   * reused. A thread holds a single set at a time, also when it
+   * processes the slabs of another label object, so new ones are only
+   * made if this no longer holds. */
+  void AcquireInterpolators( InterpolatorArrayType &interpolators );
+  void ReleaseInterpolators( InterpolatorArrayType &interpolators );
+
+  /** The oriented grid of the attribute images, and the buffers its
+   * pixels are written to, one per feature image. The buffers are laid
+   * out as an image of Size starting at the zero index, they belong to
+   * the attribute images or to a slot of the batch. The MaskBuffer may
+   * be NULL. */
+  struct ResampleGridType
+  {
+    typename AttributeImageType::PointType       Origin;
+    typename AttributeImageType::DirectionType   Direction;
+    SpacingType                                  Spacing;
+    SizeType                                     Size;
+    std::vector< AttributeImagePixelType * >     Buffers;
+    typename MaskImageType::PixelType           *MaskBuffer;
+
+    // With a projection, the samples are accumulated instead into the
+    // pixels of the grid projected along ProjectionAxis, and counted.
+    // The Accumulators are empty otherwise, and ProjectionAxis is
+    // ImageDimension.
+    unsigned int                                 ProjectionAxis;
+    std::vector< double * >                      Accumulators;
+    std::vector< SizeValueType * >               Counts;
+  };
+
+  /** Where the kernel stores the next sample of a feature image. */
+  struct OutputCursor
+  {
+    AttributeImagePixelType *Output;
+    double                  *Accumulator;
+    SizeValueType           *Count;
+    OffsetValueType          Step;
+  };
+
+  /** Store an interpolated value, or accumulate it with a projection,
+   * and move to the next sample. */
+  void StoreValue( OutputCursor &cursor, double value ) const
+    {
+    if ( cursor.Accumulator == ITK_NULLPTR )
+      {
+      *cursor.Output++ = m_IntensityMapping( value );
+      return;
+      }
+    if ( *cursor.Count == 0 )
+      {
+      *cursor.Accumulator = value;
+      }
+    else if ( m_Projection == MaximumProjection )
+      {
+      *cursor.Accumulator = std::max( *cursor.Accumulator, value );
+      }
+    else if ( m_Projection == MinimumProjection )
+      {
+      *cursor.Accumulator = std::min( *cursor.Accumulator, value );
+      }
+    else
+      {
+      *cursor.Accumulator += value;
+      }
+    ++*cursor.Count;
+    cursor.Accumulator += cursor.Step;
+    cursor.Count += cursor.Step;
+    }
+
+  /** Store the DefaultPixelValue, or skip the sample with a
+   * projection. */
+  void StoreDefault( OutputCursor &cursor ) const
+    {
+    if ( cursor.Accumulator == ITK_NULLPTR )
+      {
+      *cursor.Output++ = m_DefaultPixelValue;
+      return;
+      }
+    cursor.Accumulator += cursor.Step;
+    cursor.Count += cursor.Step;
+    }
+
+  /** Resample the input images of the interpolators onto region of
+   * the grid, brick by brick. When lineLookup is not NULL, the
+   * membership of the label object is computed, to restrict the
+   * interpolation with UseLabelObjectMask and to fill the MaskBuffer
+   * if it is not NULL. */
+  void ResampleAttributeImage( const InterpolatorArrayType &interpolators,
+                               const ResampleGridType &grid,
+                               const AttributeImageRegionType &region,
+                               const LineLookupType *lineLookup = ITK_NULLPTR ) const;
+
+  /** Resample region of the grid split into slabs along the last
+   * dimension, processed as the chunks of the LabelObjectScheduler.
+   * The dimension before is split instead when the grid is projected
+   * along the last dimension. */
+  void ThreadedResampleAttributeImage( const ResampleGridType &grid,
+                                       const AttributeImageRegionType &region,
+                                       const LineLookupType *lineLookup );
+
   virtual void PrintSelf(std::ostream & os, Indent indent) const ITK_OVERRIDE;
 
 private:
@@ -129,8 +464,103 @@ private:
   SpacingType m_PaddingOffset;
   SpacingType m_AttributeImageSpacing;
 
+  bool m_UseLabelObjectMask;
+  bool m_GenerateMaskImage;
+
+  SizeValueType m_LargeAttributeImageNumberOfPixels;
+  SizeValueType m_TraversalCacheSize;
+
+  bool     m_PrincipalPlanes;
+
+  ProjectionType m_Projection;
+  unsigned int   m_ProjectionAxis;
+
+  SizeType m_BatchPatchSize;
+
   typename InterpolatorType::Pointer m_Interpolator;
   AttributeImagePixelType            m_DefaultPixelValue;
+
+  IntensityMappingType    m_IntensityMapping;
+
+  void CreateInterpolators( InterpolatorArrayType &interpolators ) const;
+
+  static bool SameGeometry( const FeatureImageType *a, const FeatureImageType *b );
+
+  bool UseBatch() const;
+
+  // allocate one attribute image per feature image on the grid, and
+  // point the grid buffers to them
+  void AllocateAttributeImages( ResampleGridType &grid, AttributeImageArrayType &attributeImages ) const;
+
+  // resample the whole grid, split across the threads when large
+  void ResampleOnGrid( const ResampleGridType &grid, const LineLookupType *lineLookup );
+
+  // resample the slices of grid through the centroid into the
+  // attribute images of the label object
+  void ResamplePrincipalPlanes( LabelObjectType *labelObject, const ResampleGridType &grid );
+
+  // resample grid projected along the ProjectionAxis into the
+  // attribute images of the label object
+  void ResampleProjection( LabelObjectType *labelObject, ResampleGridType &grid );
+
+  typedef typename AttributeImageType::DirectionType GridMatrixType;
+
+  static GridMatrixType GridIndexToPhysical( const ResampleGridType &grid );
+
+  // the size of the bricks of region whose footprint in the feature
+  // images fits in the TraversalCacheSize
+  SizeType ComputeBrickSize( const InterpolatorArrayType &interpolators,
+                             const ResampleGridType &grid,
+                             const AttributeImageRegionType &region ) const;
+
+  // resample region of the grid in raster order
+  void ResampleAttributeImageRegion( const InterpolatorArrayType &interpolators,
+                                     const ResampleGridType &grid,
+                                     const AttributeImageRegionType &region,
+                                     const LineLookupType *lineLookup ) const;
+
+  // the slabs of ThreadedResampleAttributeImage
+  class ResampleSlabsWork:
+    public LabelObjectSchedulerType::ChunkedWork
+  {
+  public:
+    virtual void ProcessChunk( SizeValueType slab ) ITK_OVERRIDE
+    {
+      Filter->ResampleSlab( *Grid, Region, LineLookup, SplitDimension, slab, NumberOfSlabs );
+    }
+
+    Self                     *Filter;
+    const ResampleGridType   *Grid;
+    AttributeImageRegionType  Region;
+    const LineLookupType     *LineLookup;
+    unsigned int              SplitDimension;
+    SizeValueType             NumberOfSlabs;
+  };
+
+  // resample the slab-th of numberOfSlabs slabs of region along the
+  // splitDimension
+  void ResampleSlab( const ResampleGridType &grid,
+                     const AttributeImageRegionType &region,
+                     const LineLookupType *lineLookup,
+                     unsigned int splitDimension,
+                     SizeValueType slab,
+                     SizeValueType numberOfSlabs );
+
+  // clones of the interpolator bound to the feature images, not in
+  // use by a thread
+  std::vector< InterpolatorArrayType > m_InterpolatorPool;
+  SimpleFastMutexLock                  m_InterpolatorPoolMutex;
+
+  // for each feature image, the first feature image with the same
+  // geometry, and whether the linear weights are shared by all
+  std::vector< unsigned int > m_FeatureImageGeometry;
+  bool                        m_ShareLinearWeights;
+
+  // the batch mode outputs, and the slot of each label
+  std::vector< typename BatchImageType::Pointer > m_BatchImages;
+  typename BatchMaskImageType::Pointer            m_BatchMaskImage;
+  BatchLabelArrayType                             m_BatchLabels;
+  std::map< LabelType, SizeValueType >            m_BatchSlots;
 };
 
 } // end namespace itk
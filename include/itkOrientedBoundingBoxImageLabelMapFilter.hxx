@@ -19,7 +19,9 @@
 #define itkOrientedBoundingBoxImageLabelMapFilter_hxx
 
 #include "itkOrientedBoundingBoxImageLabelMapFilter.h"
-#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include <cmath>
+#include <sstream>
 
 namespace itk
 {
@@ -28,13 +30,22 @@ namespace itk
 template< class TImage, class TFeatureImage, class TLabelImage  >
 OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
 ::OrientedBoundingBoxImageLabelMapFilter()
+  : m_UseLabelObjectMask( false ),
+    m_GenerateMaskImage( false ),
+    m_LargeAttributeImageNumberOfPixels( 262144 ),
+    m_TraversalCacheSize( 262144 ),
+    m_PrincipalPlanes( false ),
+    m_Projection( NoProjection ),
+    m_ProjectionAxis( 0 ),
+    m_ShareLinearWeights( false )
 {
   this->AddRequiredInputName("FeatureImage");
 
   m_PaddingOffset.Fill(-0.5);
   m_AttributeImageSpacing.Fill(1.0);
+  m_BatchPatchSize.Fill(0);
 
-  typedef LinearInterpolateImageFunction< AttributeImageType, double >   LinearInterpolatorType;
+  typedef LinearInterpolateImageFunction< FeatureImageType, double >   LinearInterpolatorType;
   m_Interpolator = LinearInterpolatorType::New().GetPointer();
   m_DefaultPixelValue = NumericTraits<AttributeImagePixelType>::ZeroValue( m_DefaultPixelValue );
 }
@@ -50,6 +61,245 @@ OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
   this->SetPaddingOffset(offset);
 }
 
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::SetNthFeatureImage( unsigned int idx, const FeatureImageType *image )
+{
+  if ( idx == 0 )
+    {
+    this->SetFeatureImage( image );
+    return;
+    }
+
+  std::ostringstream name;
+  name << "FeatureImage" << idx;
+  this->ProcessObject::SetInput( name.str(), const_cast<FeatureImageType *>( image ) );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+const typename OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::FeatureImageType *
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::GetNthFeatureImage( unsigned int idx ) const
+{
+  if ( idx == 0 )
+    {
+    return this->GetFeatureImage();
+    }
+
+  std::ostringstream name;
+  name << "FeatureImage" << idx;
+  return static_cast<const FeatureImageType *>( this->ProcessObject::GetInput( name.str() ) );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+unsigned int
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::GetNumberOfFeatureImages() const
+{
+  unsigned int n = 0;
+  while ( this->GetNthFeatureImage( n ) != ITK_NULLPTR )
+    {
+    ++n;
+    }
+  return n;
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::BeforeThreadedGenerateData()
+{
+  Superclass::BeforeThreadedGenerateData();
+
+  if ( m_Interpolator.IsNull() )
+    {
+    itkExceptionMacro("Interpolator not set");
+    }
+
+  if ( m_PrincipalPlanes && this->UseBatch() )
+    {
+    itkExceptionMacro("PrincipalPlanes can not be used with a BatchPatchSize");
+    }
+
+  if ( m_Projection != NoProjection && ( m_PrincipalPlanes || this->UseBatch() ) )
+    {
+    itkExceptionMacro("A Projection can not be used with PrincipalPlanes or a BatchPatchSize");
+    }
+
+  if ( m_Projection != NoProjection && m_ProjectionAxis >= ImageDimension )
+    {
+    itkExceptionMacro("ProjectionAxis " << m_ProjectionAxis << " is not an axis of the box");
+    }
+
+  // The feature images with the same geometry share the mapping to
+  // the continuous index.
+  const unsigned int numberOfFeatureImages = this->GetNumberOfFeatureImages();
+  m_FeatureImageGeometry.resize( numberOfFeatureImages );
+  for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+    {
+    m_FeatureImageGeometry[f] = f;
+    for ( unsigned int g = 0; g < f; ++g )
+      {
+      if ( m_FeatureImageGeometry[g] == g
+           && SameGeometry( this->GetNthFeatureImage( f ), this->GetNthFeatureImage( g ) ) )
+        {
+        m_FeatureImageGeometry[f] = g;
+        break;
+        }
+      }
+    }
+
+  typedef LinearInterpolateImageFunction< FeatureImageType, double > LinearInterpolatorType;
+  m_ShareLinearWeights = numberOfFeatureImages > 1
+    && dynamic_cast<const LinearInterpolatorType *>( m_Interpolator.GetPointer() ) != ITK_NULLPTR;
+  for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+    {
+    m_ShareLinearWeights = m_ShareLinearWeights && m_FeatureImageGeometry[f] == 0;
+    }
+
+  // One set of interpolators per thread is bound to the feature images
+  // before the threads start. The slabs of the large attribute images
+  // are processed by the same threads, which do not hold another set
+  // meanwhile, so the pool is never exhausted.
+  m_InterpolatorPool.clear();
+  m_InterpolatorPool.resize( this->GetNumberOfThreads() );
+  for ( ThreadIdType i = 0; i < this->GetNumberOfThreads(); ++i )
+    {
+    this->CreateInterpolators( m_InterpolatorPool[i] );
+    }
+
+  // The batch is allocated for all the label objects, which are
+  // written to their slot by the threads.
+  m_BatchImages.clear();
+  m_BatchMaskImage = ITK_NULLPTR;
+  m_BatchLabels.clear();
+  m_BatchSlots.clear();
+  if ( this->UseBatch() )
+    {
+    const ImageType *output = this->GetOutput();
+    for ( typename ImageType::ConstIterator it( output ); !it.IsAtEnd(); ++it )
+      {
+      m_BatchSlots[it.GetLabel()] = m_BatchLabels.size();
+      m_BatchLabels.push_back( it.GetLabel() );
+      }
+
+    typename BatchImageType::RegionType batchRegion;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      batchRegion.SetSize( i, m_BatchPatchSize[i] );
+      }
+    batchRegion.SetSize( ImageDimension, m_BatchLabels.size() );
+
+    m_BatchImages.resize( numberOfFeatureImages );
+    for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+      {
+      m_BatchImages[f] = BatchImageType::New();
+      m_BatchImages[f]->SetRegions( batchRegion );
+      m_BatchImages[f]->Allocate();
+      }
+
+    if ( m_GenerateMaskImage )
+      {
+      m_BatchMaskImage = BatchMaskImageType::New();
+      m_BatchMaskImage->SetRegions( batchRegion );
+      m_BatchMaskImage->Allocate();
+      }
+    }
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::AfterThreadedGenerateData()
+{
+  m_InterpolatorPool.clear();
+
+  Superclass::AfterThreadedGenerateData();
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::CreateInterpolators( InterpolatorArrayType &interpolators ) const
+{
+  interpolators.resize( m_FeatureImageGeometry.size() );
+  for ( unsigned int f = 0; f < interpolators.size(); ++f )
+    {
+    interpolators[f] = dynamic_cast<InterpolatorType *>( m_Interpolator->Clone().GetPointer() );
+    if ( interpolators[f].IsNull() )
+      {
+      itkExceptionMacro("Unable to clone the interpolator " << m_Interpolator->GetNameOfClass() );
+      }
+    interpolators[f]->SetInputImage( this->GetNthFeatureImage( f ) );
+    }
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::AcquireInterpolators( InterpolatorArrayType &interpolators )
+{
+  {
+  MutexLockHolder<SimpleFastMutexLock> lock( m_InterpolatorPoolMutex );
+  if ( !m_InterpolatorPool.empty() )
+    {
+    interpolators.swap( m_InterpolatorPool.back() );
+    m_InterpolatorPool.pop_back();
+    return;
+    }
+  }
+  this->CreateInterpolators( interpolators );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ReleaseInterpolators( InterpolatorArrayType &interpolators )
+{
+  MutexLockHolder<SimpleFastMutexLock> lock( m_InterpolatorPoolMutex );
+  m_InterpolatorPool.push_back( InterpolatorArrayType() );
+  m_InterpolatorPool.back().swap( interpolators );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+typename OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::BatchImageType *
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::GetBatchImage( unsigned int idx )
+{
+  if ( idx >= m_BatchImages.size() )
+    {
+    return ITK_NULLPTR;
+    }
+  return m_BatchImages[idx];
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+bool
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::UseBatch() const
+{
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    if ( m_BatchPatchSize[i] == 0 )
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+bool
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::SameGeometry( const FeatureImageType *a, const FeatureImageType *b )
+{
+  return a->GetOrigin() == b->GetOrigin()
+    && a->GetSpacing() == b->GetSpacing()
+    && a->GetDirection() == b->GetDirection()
+    && a->GetBufferedRegion() == b->GetBufferedRegion();
+}
+
 template< class TImage, class TFeatureImage, class TLabelImage >
 void
 OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
@@ -57,48 +307,743 @@ OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
 {
   Superclass::ThreadedProcessLabelObject(labelObject);
 
-  // create a shallow copy for the first image, so that the pipeline
-  // calls do not go beyond this method.
-  typename FeatureImageType::Pointer feature = FeatureImageType::New();
-  feature->Graft( this->GetFeatureImage() );
-
   // transform padding offset from offset in output basis to physical
   // space
 
   Vector<double,ImageDimension> offset = labelObject->GetOrientedBoundingBoxDirection()*m_PaddingOffset;
 
-  typedef itk::ResampleImageFilter<FeatureImageType, AttributeImageType> ResampleFilter;
+  const unsigned int numberOfFeatureImages = static_cast<unsigned int>( m_FeatureImageGeometry.size() );
+
+  ResampleGridType grid;
+  grid.Origin = labelObject->GetOrientedBoundingBoxOrigin()-offset;
+  grid.Direction = labelObject->GetOrientedBoundingBoxDirection();
+  grid.Buffers.resize( numberOfFeatureImages );
+  grid.MaskBuffer = ITK_NULLPTR;
+  grid.ProjectionAxis = ImageDimension;
+
+  AttributeImageArrayType attributeImages;
+  typename MaskImageType::Pointer maskImage;
+
+  if ( this->UseBatch() )
+    {
+    // the spacing is set so the patch spans the padded box, and the
+    // pixels are written directly into the slot of the label object.
+    // Along an axis where the padded box is flat, or with a single
+    // pixel, the AttributeImageSpacing is used as in the other modes,
+    // with the patch centered on the box.
+    grid.Size = m_BatchPatchSize;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      const double extent = labelObject->GetOrientedBoundingBoxSize()[i]+2.0*m_PaddingOffset[i];
+      if ( m_BatchPatchSize[i] > 1 && extent > 0.0 )
+        {
+        grid.Spacing[i] = extent / ( m_BatchPatchSize[i] - 1 );
+        }
+      else
+        {
+        grid.Spacing[i] = m_AttributeImageSpacing[i];
+        const double shift = 0.5 * ( extent - ( m_BatchPatchSize[i] - 1 ) * grid.Spacing[i] );
+        for ( unsigned int j = 0; j < ImageDimension; ++j )
+          {
+          grid.Origin[j] += grid.Direction(j,i) * shift;
+          }
+        }
+      }
+
+    SizeValueType patchNumberOfPixels = 1;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      patchNumberOfPixels *= m_BatchPatchSize[i];
+      }
+    const SizeValueType slotOffset = m_BatchSlots.find( labelObject->GetLabel() )->second * patchNumberOfPixels;
+    for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+      {
+      grid.Buffers[f] = m_BatchImages[f]->GetBufferPointer() + slotOffset;
+      }
+    if ( m_GenerateMaskImage )
+      {
+      grid.MaskBuffer = m_BatchMaskImage->GetBufferPointer() + slotOffset;
+      }
+    }
+  else
+    {
+    grid.Spacing = m_AttributeImageSpacing;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      if ( m_PaddingOffset[i] < 0 && labelObject->GetOrientedBoundingBoxSize()[i]  <= -2.0*m_PaddingOffset[i] )
+        {
+        grid.Size[i] = 1;
+        }
+      else
+        {
+        grid.Size[i] = Math::Round<itk::SizeValueType>( (labelObject->GetOrientedBoundingBoxSize()[i]+2.0*m_PaddingOffset[i])/m_AttributeImageSpacing[i] )+1;
+        }
+      }
+
+    if ( m_PrincipalPlanes )
+      {
+      this->ResamplePrincipalPlanes( labelObject, grid );
+      return;
+      }
+
+    if ( m_Projection != NoProjection )
+      {
+      this->ResampleProjection( labelObject, grid );
+      return;
+      }
+
+    this->AllocateAttributeImages( grid, attributeImages );
+
+    if ( m_GenerateMaskImage )
+      {
+      maskImage = MaskImageType::New();
+      maskImage->CopyInformation(attributeImages[0]);
+      maskImage->SetRegions(attributeImages[0]->GetLargestPossibleRegion());
+      maskImage->Allocate();
+      grid.MaskBuffer = maskImage->GetBufferPointer();
+      }
+    }
+
+  LineLookupType lineLookup;
+  if ( m_UseLabelObjectMask || m_GenerateMaskImage )
+    {
+    lineLookup.Initialize(labelObject);
+    }
+
+  this->ResampleOnGrid( grid, ( m_UseLabelObjectMask || m_GenerateMaskImage ) ? &lineLookup : ITK_NULLPTR );
+
+  labelObject->SetNumberOfAttributeImages(attributeImages.size());
+  for ( unsigned int f = 0; f < attributeImages.size(); ++f )
+    {
+    labelObject->SetNthAttributeImage(f, attributeImages[f]);
+    }
+  labelObject->SetMaskImage(maskImage);
+
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ResamplePrincipalPlanes( LabelObjectType *labelObject, const ResampleGridType &grid )
+{
+  const unsigned int numberOfFeatureImages = static_cast<unsigned int>( m_FeatureImageGeometry.size() );
+
+  LineLookupType lineLookup;
+  if ( m_UseLabelObjectMask )
+    {
+    lineLookup.Initialize(labelObject);
+    }
+
+  // the position of the centroid along the axes of the box, from the
+  // origin of the grid
+  const typename LabelObjectType::CentroidType & centroid = labelObject->GetCentroid();
+
+  labelObject->SetNumberOfAttributeImages( numberOfFeatureImages * ImageDimension );
+  for ( unsigned int k = 0; k < ImageDimension; ++k )
+    {
+    double position = 0.0;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      position += grid.Direction(i,k) * ( centroid[i] - grid.Origin[i] );
+      }
+
+    // the slice of the grid normal to the k-th axis, through the
+    // centroid
+    ResampleGridType slice = grid;
+    slice.Size[k] = 1;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      slice.Origin[i] += grid.Direction(i,k) * position;
+      }
+
+    AttributeImageArrayType attributeImages;
+    this->AllocateAttributeImages( slice, attributeImages );
+    this->ResampleOnGrid( slice, m_UseLabelObjectMask ? &lineLookup : ITK_NULLPTR );
+
+    for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+      {
+      labelObject->SetNthAttributeImage( f * ImageDimension + k, attributeImages[f] );
+      }
+    }
+  labelObject->SetMaskImage( ITK_NULLPTR );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ResampleProjection( LabelObjectType *labelObject, ResampleGridType &grid )
+{
+  const unsigned int numberOfFeatureImages = static_cast<unsigned int>( m_FeatureImageGeometry.size() );
+
+  LineLookupType lineLookup;
+  if ( m_UseLabelObjectMask )
+    {
+    lineLookup.Initialize(labelObject);
+    }
+
+  // the attribute images are allocated on the projected grid, the
+  // whole grid is only walked
+  ResampleGridType projected = grid;
+  projected.Size[m_ProjectionAxis] = 1;
+
+  AttributeImageArrayType attributeImages;
+  this->AllocateAttributeImages( projected, attributeImages );
+
+  const SizeValueType numberOfPixels = attributeImages[0]->GetLargestPossibleRegion().GetNumberOfPixels();
+  std::vector< std::vector<double> >        accumulators( numberOfFeatureImages );
+  std::vector< std::vector<SizeValueType> > counts( numberOfFeatureImages );
+  grid.ProjectionAxis = m_ProjectionAxis;
+  grid.Accumulators.resize( numberOfFeatureImages );
+  grid.Counts.resize( numberOfFeatureImages );
+  for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+    {
+    accumulators[f].resize( numberOfPixels, 0.0 );
+    counts[f].resize( numberOfPixels, 0 );
+    grid.Accumulators[f] = &accumulators[f][0];
+    grid.Counts[f] = &counts[f][0];
+    }
+
+  this->ResampleOnGrid( grid, m_UseLabelObjectMask ? &lineLookup : ITK_NULLPTR );
+
+  labelObject->SetNumberOfAttributeImages( numberOfFeatureImages );
+  for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+    {
+    AttributeImagePixelType *buffer = attributeImages[f]->GetBufferPointer();
+    for ( SizeValueType n = 0; n < numberOfPixels; ++n )
+      {
+      if ( counts[f][n] == 0 )
+        {
+        buffer[n] = m_DefaultPixelValue;
+        }
+      else if ( m_Projection == MeanProjection )
+        {
+        buffer[n] = m_IntensityMapping( accumulators[f][n] / static_cast<double>( counts[f][n] ) );
+        }
+      else
+        {
+        buffer[n] = m_IntensityMapping( accumulators[f][n] );
+        }
+      }
+    labelObject->SetNthAttributeImage( f, attributeImages[f] );
+    }
+  labelObject->SetMaskImage( ITK_NULLPTR );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::AllocateAttributeImages( ResampleGridType &grid, AttributeImageArrayType &attributeImages ) const
+{
+  AttributeImageRegionType region;
+  region.SetSize(grid.Size);
+
+  attributeImages.resize( m_FeatureImageGeometry.size() );
+  grid.Buffers.resize( attributeImages.size() );
+  for ( unsigned int f = 0; f < attributeImages.size(); ++f )
+    {
+    attributeImages[f] = AttributeImageType::New();
+    attributeImages[f]->SetRegions(region);
+    attributeImages[f]->SetDirection(grid.Direction);
+    attributeImages[f]->SetOrigin(grid.Origin);
+    attributeImages[f]->SetSpacing(grid.Spacing);
+    attributeImages[f]->Allocate();
+    grid.Buffers[f] = attributeImages[f]->GetBufferPointer();
+    }
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ResampleOnGrid( const ResampleGridType &grid, const LineLookupType *lineLookup )
+{
+  AttributeImageRegionType region;
+  region.SetSize(grid.Size);
 
-  typename ResampleFilter::Pointer resampler = ResampleFilter::New();
+  if ( m_LargeAttributeImageNumberOfPixels != 0
+       && region.GetNumberOfPixels() >= m_LargeAttributeImageNumberOfPixels
+       && this->GetNumberOfThreads() > 1 )
+    {
+    this->ThreadedResampleAttributeImage( grid, region, lineLookup );
+    }
+  else
+    {
+    InterpolatorArrayType interpolators;
+    this->AcquireInterpolators( interpolators );
+    this->ResampleAttributeImage( interpolators, grid, region, lineLookup );
+    this->ReleaseInterpolators( interpolators );
+    }
+}
 
-  typename AttributeImageType::SizeType outSize;
+template< class TImage, class TFeatureImage, class TLabelImage >
+typename OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::GridMatrixType
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::GridIndexToPhysical( const ResampleGridType &grid )
+{
+  GridMatrixType indexToPhysical = grid.Direction;
   for ( unsigned int i = 0; i < ImageDimension; ++i )
     {
-    if ( m_PaddingOffset[i] < 0 && labelObject->GetOrientedBoundingBoxSize()[i]  <= -2.0*m_PaddingOffset[i] )
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      indexToPhysical(i,j) *= grid.Spacing[j];
+      }
+    }
+  return indexToPhysical;
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+typename OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >::SizeType
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ComputeBrickSize( const InterpolatorArrayType &interpolators,
+                    const ResampleGridType &grid,
+                    const AttributeImageRegionType &region ) const
+{
+  SizeType brickSize = region.GetSize();
+  if ( m_TraversalCacheSize == 0 )
+    {
+    return brickSize;
+    }
+
+  const GridMatrixType indexToPhysical = GridIndexToPhysical( grid );
+
+  // the absolute value of the map to the continuous index of each
+  // feature image
+  std::vector<GridMatrixType> footprint( interpolators.size() );
+  for ( unsigned int f = 0; f < interpolators.size(); ++f )
+    {
+    footprint[f] = interpolators[f]->GetInputImage()->GetPhysicalPointToIndex() * indexToPhysical;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
       {
-      outSize[i] = 1;
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+        footprint[f](i,j) = std::abs( footprint[f](i,j) );
+        }
+      }
+    }
+
+  // Halve the longest side of the brick until the bounding box of its
+  // footprint in the feature images, with the neighbors of the
+  // interpolation, fits in the cache. The first dimension is only
+  // halved once the other sides are down to a single pixel, to keep
+  // the scanlines long.
+  while ( true )
+    {
+    double bytes = 0.0;
+    for ( unsigned int f = 0; f < interpolators.size(); ++f )
+      {
+      double pixels = 1.0;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        double extent = 2.0;
+        for ( unsigned int j = 0; j < ImageDimension; ++j )
+          {
+          extent += footprint[f](i,j) * static_cast<double>( brickSize[j] - 1 );
+          }
+        pixels *= extent;
+        }
+      bytes += pixels * sizeof( typename FeatureImageType::PixelType );
+      }
+    if ( bytes <= static_cast<double>( m_TraversalCacheSize ) )
+      {
+      break;
+      }
+
+    unsigned int longest = 0;
+    for ( unsigned int j = 1; j < ImageDimension; ++j )
+      {
+      if ( brickSize[j] > 1 && ( longest == 0 || brickSize[j] > brickSize[longest] ) )
+        {
+        longest = j;
+        }
+      }
+    if ( brickSize[longest] <= 1 )
+      {
+      break;
+      }
+    brickSize[longest] = ( brickSize[longest] + 1 ) / 2;
+    }
+
+  return brickSize;
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ResampleAttributeImage( const InterpolatorArrayType &interpolators,
+                          const ResampleGridType &grid,
+                          const AttributeImageRegionType &region,
+                          const LineLookupType *lineLookup ) const
+{
+  if ( region.GetNumberOfPixels() == 0 || interpolators.empty() )
+    {
+    return;
+    }
+
+  const SizeType brickSize = this->ComputeBrickSize( interpolators, grid, region );
+
+  // the bricks of the region, in raster order
+  typename AttributeImageType::IndexType brickIndex = region.GetIndex();
+  while ( true )
+    {
+    AttributeImageRegionType brick;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      const IndexValueType end = region.GetIndex(i) + static_cast<IndexValueType>( region.GetSize(i) );
+      brick.SetIndex( i, brickIndex[i] );
+      brick.SetSize( i, std::min<SizeValueType>( brickSize[i], end - brickIndex[i] ) );
+      }
+    this->ResampleAttributeImageRegion( interpolators, grid, brick, lineLookup );
+
+    unsigned int j = 0;
+    for ( ; j < ImageDimension; ++j )
+      {
+      brickIndex[j] += static_cast<IndexValueType>( brickSize[j] );
+      if ( brickIndex[j] < region.GetIndex(j) + static_cast<IndexValueType>( region.GetSize(j) ) )
+        {
+        break;
+        }
+      brickIndex[j] = region.GetIndex(j);
+      }
+    if ( j == ImageDimension )
+      {
+      break;
+      }
+    }
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ResampleAttributeImageRegion( const InterpolatorArrayType &interpolators,
+                                const ResampleGridType &grid,
+                                const AttributeImageRegionType &region,
+                                const LineLookupType *lineLookup ) const
+{
+  typedef typename InterpolatorType::ContinuousIndexType   ContinuousIndexType;
+  typedef typename AttributeImageType::IndexType           AttributeImageIndexType;
+  typedef typename AttributeImageType::PointType           AttributeImagePointType;
+  typedef typename FeatureImageType::PixelType             FeatureImagePixelType;
+  typedef Matrix<double, ImageDimension, ImageDimension>   MatrixType;
+
+  const unsigned int numberOfFeatureImages = static_cast<unsigned int>( interpolators.size() );
+
+  if ( region.GetNumberOfPixels() == 0 || numberOfFeatureImages == 0 )
+    {
+    return;
+    }
+
+  // Both images map the index to the physical space with an affine
+  // transform, so the continuous index in the feature image of the
+  // attribute image index k is start + indexToFeature*(k-regionIndex).
+  // It is only computed for the first feature image of each geometry.
+  const MatrixType indexToPhysical = GridIndexToPhysical( grid );
+
+  const AttributeImageIndexType & regionIndex = region.GetIndex();
+  AttributeImagePointType regionOrigin = grid.Origin;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      regionOrigin[i] += indexToPhysical(i,j) * static_cast<double>( regionIndex[j] );
+      }
+    }
+
+  // the offsets of the grid buffers
+  OffsetValueType gridOffsetTable[ImageDimension];
+  gridOffsetTable[0] = 1;
+  for ( unsigned int j = 1; j < ImageDimension; ++j )
+    {
+    gridOffsetTable[j] = gridOffsetTable[j-1] * static_cast<OffsetValueType>( grid.Size[j-1] );
+    }
+
+  std::vector<MatrixType>          indexToFeature( numberOfFeatureImages );
+  std::vector<ContinuousIndexType> start( numberOfFeatureImages );
+  for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+    {
+    if ( m_FeatureImageGeometry[f] == f )
+      {
+      const FeatureImageType *feature = interpolators[f]->GetInputImage();
+      indexToFeature[f] = feature->GetPhysicalPointToIndex() * indexToPhysical;
+      feature->TransformPhysicalPointToContinuousIndex( regionOrigin, start[f] );
+      }
+    }
+
+  // the same mapping to the continuous index of the label map, for
+  // the membership of the label object
+  const ImageType *labelMap = this->GetOutput();
+  const MatrixType indexToLabelMap = labelMap->GetPhysicalPointToIndex() * indexToPhysical;
+  ContinuousIndexType labelMapStart;
+  labelMap->TransformPhysicalPointToContinuousIndex( regionOrigin, labelMapStart );
+
+  const bool restrictToLabelObject = lineLookup != ITK_NULLPTR && m_UseLabelObjectMask;
+
+  // With the linear interpolator and a single geometry, the neighbors
+  // and weights are computed once and applied to all the buffers, as
+  // LinearInterpolateImageFunction does.
+  const unsigned int numberOfNeighbors = 1u << ImageDimension;
+  OffsetValueType    neighborOffset[1u << ImageDimension];
+  double             neighborWeight[1u << ImageDimension];
+  std::vector<const FeatureImagePixelType *> featureBuffers( numberOfFeatureImages );
+  const FeatureImageType *firstFeature = interpolators[0]->GetInputImage();
+  const typename FeatureImageType::RegionType & featureRegion = firstFeature->GetBufferedRegion();
+  const OffsetValueType *featureOffsetTable = firstFeature->GetOffsetTable();
+  for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+    {
+    featureBuffers[f] = interpolators[f]->GetInputImage()->GetBufferPointer();
+    }
+
+  std::vector<ContinuousIndexType>       cindex( numberOfFeatureImages );
+  std::vector<OutputCursor> output( numberOfFeatureImages );
+
+  // With a projection, the samples are accumulated into the pixel of
+  // the projected grid, the index along the projection axis is
+  // dropped.
+  const bool project = !grid.Accumulators.empty();
+  OffsetValueType projectedOffsetTable[ImageDimension];
+  projectedOffsetTable[0] = 1;
+  for ( unsigned int j = 1; j < ImageDimension; ++j )
+    {
+    projectedOffsetTable[j] = projectedOffsetTable[j-1]
+      * ( j-1 == grid.ProjectionAxis ? 1 : static_cast<OffsetValueType>( grid.Size[j-1] ) );
+    }
+  if ( project )
+    {
+    projectedOffsetTable[grid.ProjectionAxis] = 0;
+    }
+
+  const SizeValueType lineLength = region.GetSize(0);
+  const SizeValueType numberOfLines = region.GetNumberOfPixels() / lineLength;
+
+  AttributeImageIndexType lineIndex = regionIndex;
+  for ( SizeValueType line = 0; line < numberOfLines; ++line )
+    {
+    // the first point of the line is computed from the start so the
+    // stepping error does not accumulate across the lines
+    for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+      {
+      if ( m_FeatureImageGeometry[f] != f )
+        {
+        continue;
+        }
+      cindex[f] = start[f];
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        for ( unsigned int j = 1; j < ImageDimension; ++j )
+          {
+          cindex[f][i] += indexToFeature[f](i,j) * static_cast<double>( lineIndex[j] - regionIndex[j] );
+          }
+        }
+      }
+
+    ContinuousIndexType labelMapIndex = labelMapStart;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      for ( unsigned int j = 1; j < ImageDimension; ++j )
+        {
+        labelMapIndex[i] += indexToLabelMap(i,j) * static_cast<double>( lineIndex[j] - regionIndex[j] );
+        }
+      }
+
+    OffsetValueType lineOffset = 0;
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      lineOffset += static_cast<OffsetValueType>( lineIndex[j] ) * gridOffsetTable[j];
+      }
+    if ( project )
+      {
+      OffsetValueType projectedOffset = 0;
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+        projectedOffset += static_cast<OffsetValueType>( lineIndex[j] ) * projectedOffsetTable[j];
+        }
+      for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+        {
+        output[f].Accumulator = grid.Accumulators[f] + projectedOffset;
+        output[f].Count = grid.Counts[f] + projectedOffset;
+        output[f].Step = projectedOffsetTable[0];
+        }
       }
     else
       {
-      outSize[i] = Math::Round<itk::SizeValueType>( (labelObject->GetOrientedBoundingBoxSize()[i]+2.0*m_PaddingOffset[i])/m_AttributeImageSpacing[i] )+1;
+      for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+        {
+        output[f].Output = grid.Buffers[f] + lineOffset;
+        output[f].Accumulator = ITK_NULLPTR;
+        }
+      }
+    typename MaskImageType::PixelType *maskPtr = ITK_NULLPTR;
+    if ( grid.MaskBuffer != ITK_NULLPTR )
+      {
+      maskPtr = grid.MaskBuffer + lineOffset;
+      }
+
+    for ( SizeValueType k = 0; k < lineLength; ++k )
+      {
+      bool inside = true;
+      if ( lineLookup != ITK_NULLPTR )
+        {
+        IndexType nearest;
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          nearest[i] = Math::RoundHalfIntegerUp<IndexValueType>( labelMapIndex[i] );
+          labelMapIndex[i] += indexToLabelMap(i,0);
+          }
+        inside = lineLookup->IsInside( nearest );
+        if ( maskPtr != ITK_NULLPTR )
+          {
+          *maskPtr++ = inside;
+          }
+        }
+
+      if ( !inside && restrictToLabelObject )
+        {
+        for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+          {
+          this->StoreDefault( output[f] );
+          }
+        }
+      else if ( m_ShareLinearWeights )
+        {
+        if ( interpolators[0]->IsInsideBuffer( cindex[0] ) )
+          {
+          IndexValueType baseIndex[ImageDimension];
+          double         distance[ImageDimension];
+          for ( unsigned int i = 0; i < ImageDimension; ++i )
+            {
+            baseIndex[i] = Math::Floor<IndexValueType>( cindex[0][i] );
+            distance[i] = cindex[0][i] - static_cast<double>( baseIndex[i] );
+            }
+          for ( unsigned int n = 0; n < numberOfNeighbors; ++n )
+            {
+            neighborOffset[n] = 0;
+            neighborWeight[n] = 1.0;
+            for ( unsigned int i = 0; i < ImageDimension; ++i )
+              {
+              IndexValueType neighbor;
+              if ( n & ( 1u << i ) )
+                {
+                neighbor = std::min( baseIndex[i] + 1, featureRegion.GetIndex(i) + static_cast<IndexValueType>( featureRegion.GetSize(i) ) - 1 );
+                neighborWeight[n] *= distance[i];
+                }
+              else
+                {
+                neighbor = std::max( baseIndex[i], featureRegion.GetIndex(i) );
+                neighborWeight[n] *= 1.0 - distance[i];
+                }
+              neighborOffset[n] += ( neighbor - featureRegion.GetIndex(i) ) * featureOffsetTable[i];
+              }
+            }
+          for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+            {
+            double value = 0.0;
+            for ( unsigned int n = 0; n < numberOfNeighbors; ++n )
+              {
+              value += neighborWeight[n] * static_cast<double>( featureBuffers[f][neighborOffset[n]] );
+              }
+            this->StoreValue( output[f], value );
+            }
+          }
+        else
+          {
+          for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+            {
+            this->StoreDefault( output[f] );
+            }
+          }
+        }
+      else
+        {
+        for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+          {
+          const ContinuousIndexType & featureIndex = cindex[m_FeatureImageGeometry[f]];
+          if ( interpolators[f]->IsInsideBuffer( featureIndex ) )
+            {
+            this->StoreValue( output[f], interpolators[f]->EvaluateAtContinuousIndex( featureIndex ) );
+            }
+          else
+            {
+            this->StoreDefault( output[f] );
+            }
+          }
+        }
+
+      for ( unsigned int f = 0; f < numberOfFeatureImages; ++f )
+        {
+        if ( m_FeatureImageGeometry[f] != f )
+          {
+          continue;
+          }
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          cindex[f][i] += indexToFeature[f](i,0);
+          }
+        }
+      }
+
+    // move to the next line of the region
+    for ( unsigned int j = 1; j < ImageDimension; ++j )
+      {
+      if ( ++lineIndex[j] < regionIndex[j] + static_cast<IndexValueType>( region.GetSize(j) ) )
+        {
+        break;
+        }
+      lineIndex[j] = regionIndex[j];
       }
     }
+}
 
-  resampler->SetOutputDirection(labelObject->GetOrientedBoundingBoxDirection());
-  resampler->SetOutputOrigin(labelObject->GetOrientedBoundingBoxOrigin()-offset);
-  resampler->SetOutputSpacing(this->m_AttributeImageSpacing);
-  resampler->SetSize(outSize);
-  // Using the same interpolator in multiple filters is causing segfaults.
-  //resampler->SetInterpolator(m_Interpolator);
-  resampler->SetDefaultPixelValue(m_DefaultPixelValue);
-  resampler->SetInput(feature);
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ThreadedResampleAttributeImage( const ResampleGridType &grid,
+                                  const AttributeImageRegionType &region,
+                                  const LineLookupType *lineLookup )
+{
+  // The threads write to disjoint slabs, so with a projection they are
+  // not split along the projection axis.
+  unsigned int splitDimension = ImageDimension - 1;
+  if ( splitDimension == grid.ProjectionAxis && splitDimension > 0 )
+    {
+    --splitDimension;
+    }
 
-  resampler->SetNumberOfThreads(1);
+  ResampleSlabsWork work;
+  work.Filter = this;
+  work.Grid = &grid;
+  work.Region = region;
+  work.LineLookup = lineLookup;
+  work.SplitDimension = splitDimension;
+  work.NumberOfSlabs = std::min<SizeValueType>( this->GetNumberOfThreads() * LabelObjectSchedulerType::ChunksPerThread,
+                                                region.GetSize( splitDimension ) );
 
-  resampler->UpdateLargestPossibleRegion();
+  this->GetLabelObjectScheduler()->ProcessChunks( work, work.NumberOfSlabs );
+}
+
+template< class TImage, class TFeatureImage, class TLabelImage >
+void
+OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
+::ResampleSlab( const ResampleGridType &grid,
+                const AttributeImageRegionType &region,
+                const LineLookupType *lineLookup,
+                unsigned int splitDimension,
+                SizeValueType slab,
+                SizeValueType numberOfSlabs )
+{
+  const SizeValueType size = region.GetSize( splitDimension );
+  const SizeValueType begin = ( size * slab ) / numberOfSlabs;
+  const SizeValueType end = ( size * ( slab + 1 ) ) / numberOfSlabs;
+  if ( begin == end )
+    {
+    return;
+    }
 
-  labelObject->SetAttributeImage(resampler->GetOutput());
+  AttributeImageRegionType slabRegion = region;
+  slabRegion.SetIndex( splitDimension, region.GetIndex( splitDimension ) + static_cast<IndexValueType>( begin ) );
+  slabRegion.SetSize( splitDimension, end - begin );
 
+  InterpolatorArrayType interpolators;
+  this->AcquireInterpolators( interpolators );
+  this->ResampleAttributeImage( interpolators, grid, slabRegion, lineLookup );
+  this->ReleaseInterpolators( interpolators );
 }
 
 template< class TImage, class TFeatureImage, class TLabelImage  >
@@ -110,9 +1055,18 @@ OrientedBoundingBoxImageLabelMapFilter< TImage, TFeatureImage, TLabelImage >
 
   os << indent << "PaddingOffset: " << m_PaddingOffset << std::endl;
   os << indent << "AttributeimageSpacing: " << m_AttributeImageSpacing << std::endl;
+  os << indent << "UseLabelObjectMask: " << m_UseLabelObjectMask << std::endl;
+  os << indent << "GenerateMaskImage: " << m_GenerateMaskImage << std::endl;
+  os << indent << "LargeAttributeImageNumberOfPixels: " << m_LargeAttributeImageNumberOfPixels << std::endl;
+  os << indent << "TraversalCacheSize: " << m_TraversalCacheSize << std::endl;
+  os << indent << "PrincipalPlanes: " << m_PrincipalPlanes << std::endl;
+  os << indent << "Projection: " << static_cast<int>( m_Projection ) << std::endl;
+  os << indent << "ProjectionAxis: " << m_ProjectionAxis << std::endl;
+  os << indent << "BatchPatchSize: " << m_BatchPatchSize << std::endl;
 
   os << indent << "Interpolator: " << m_Interpolator << std::endl;
   os << indent << "DefaultPixelValue: " << m_DefaultPixelValue << std::endl;
+  m_IntensityMapping.Print(os, indent);
 }
 
 } // end namespace itk
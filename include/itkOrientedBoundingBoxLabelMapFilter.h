@@ -20,11 +20,49 @@
 
 #include "itkInPlaceLabelMapFilter.h"
 #include "itkShapeLabelMapFilter.h"
+#include "itkLabelObjectLineReducer.h"
+#include "itkScheduledLabelMapFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace itk
 {
 
 /** \class OrientedBoundingBoxLabelMapFilter
+ *
+ * Label objects are distributed across the threads. Additionally,
+ * the lines of a label object with at least
+ * LargeLabelObjectNumberOfLines lines are partitioned into chunks
+ * processed by the threads which have run out of label objects, so
+ * that a single dominant label does not leave the other threads
+ * idle.
+ *
+ * By default the box is aligned with the principal axes of the label
+ * object. With ComputeMinimumVolume enabled, the box of minimum area
+ * (2D) or approximately minimum volume (3D) is computed instead. The
+ * object is first reduced to the convex hull of its pixel corners,
+ * computed slice by slice from the row extents, which is a small
+ * fraction of the 2*numLines line end points. In 2D the exact
+ * minimum area rectangle of the hull is found with rotating
+ * calipers. In 3D one box axis is searched over a set of candidate
+ * directions, the principal axes, the image axes and
+ * MinimumVolumeSearchDirections additional directions, and for each
+ * the minimum area rectangle of the hull projected onto the
+ * orthogonal plane is computed. The axis of the best candidate is
+ * then refined by a local search, so the result is a local minimum
+ * of the volume, not always the global one. As the principal axes
+ * are candidates, the result is never larger than the box of the
+ * pixel corners aligned with the principal axes.
+ *
+ * An approximate box can be computed from a subset of the lines, see
+ * DecimationFactor, with a guaranteed error bound for each object.
+ *
+ * The centroid and principal axes are computed by the superclass,
+ * ShapeLabelMapFilter by default. PrincipalMomentsLabelMapFilter can
+ * be used instead when the other shape attributes are not needed.
+ *
  * \ingroup ITKLabelMap
  * \ingroup ITKOBBLabelMap
  */
@@ -32,14 +70,14 @@ namespace itk
 template< class TImage,
           class TSuperclass = ShapeLabelMapFilter<TImage> >
 class OrientedBoundingBoxLabelMapFilter:
-  public TSuperclass
+  public ScheduledLabelMapFilter< TSuperclass >
 {
 public:
   /** Standard class typedefs. */
-  typedef OrientedBoundingBoxLabelMapFilter Self;
-  typedef TSuperclass                       Superclass;
-  typedef SmartPointer< Self >              Pointer;
-  typedef SmartPointer< const Self >        ConstPointer;
+  typedef OrientedBoundingBoxLabelMapFilter       Self;
+  typedef ScheduledLabelMapFilter< TSuperclass >  Superclass;
+  typedef SmartPointer< Self >                    Pointer;
+  typedef SmartPointer< const Self >              ConstPointer;
 
   /** Some convenient typedefs. */
   typedef TImage                               ImageType;
@@ -49,8 +87,12 @@ public:
   typedef typename ImageType::IndexType        IndexType;
   typedef typename ImageType::SizeType         SizeType;
   typedef typename ImageType::LabelObjectType  LabelObjectType;
+  typedef typename LabelObjectType::LineType   LineType;
 
   typedef typename LabelObjectType::MatrixType MatrixType;
+  typedef Vector<double, TImage::ImageDimension> VectorType;
+
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
 
   /** ImageDimension constants */
   itkStaticConstMacro(ImageDimension, unsigned int, TImage::ImageDimension);
@@ -59,19 +101,294 @@ public:
   itkNewMacro(Self);
 
   /** Runtime information support. */
-  itkTypeMacro(OrientedBoundingBoxLabelMapFilter, TSuperclass);
+  itkTypeMacro(OrientedBoundingBoxLabelMapFilter, ScheduledLabelMapFilter);
+
+  /** Set/Get the number of lines below which a label object is
+   * processed by a specialized path using only stack storage. Zero
+   * disables the specialized path. Defaults to 16.
+   */
+  itkSetMacro(SmallLabelObjectNumberOfLines, SizeValueType);
+  itkGetConstMacro(SmallLabelObjectNumberOfLines, SizeValueType);
+
+  /** Set/Get whether a label object made of a single line, or a
+   * single pixel, gets the exact box of its pixels aligned with the
+   * image axes. The principal axes of such an object are arbitrary
+   * across the line, so the box aligned with them is usually too
+   * large, but this changes the direction of the box to the image
+   * axes. Defaults to Off.
+   */
+  itkSetMacro(AlignSingleLinesWithImageAxes, bool);
+  itkGetConstMacro(AlignSingleLinesWithImageAxes, bool);
+  itkBooleanMacro(AlignSingleLinesWithImageAxes);
+
+  /** Set/Get whether the box of minimum area or volume is computed
+   * instead of the box aligned with the principal axes. Defaults to
+   * Off.
+   */
+  itkSetMacro(ComputeMinimumVolume, bool);
+  itkGetConstMacro(ComputeMinimumVolume, bool);
+  itkBooleanMacro(ComputeMinimumVolume);
+
+  /** Set/Get the number of directions, spread uniformly over the
+   * hemisphere, searched in addition to the principal and image axes
+   * for the minimum volume box in 3D. The best candidate is then
+   * refined locally, so a coarse sampling is enough to find a box
+   * which is not aligned with the principal or image axes. Defaults
+   * to 32.
+   */
+  itkSetMacro(MinimumVolumeSearchDirections, unsigned int);
+  itkGetConstMacro(MinimumVolumeSearchDirections, unsigned int);
+
+  /** Set/Get the decimation factor of the approximate mode. When
+   * greater than one, the box aligned with the principal axes is
+   * computed from every DecimationFactor-th RLE line of each label
+   * object, and the last one; the other lines are not visited. The
+   * guaranteed bound of the error is stored in the
+   * OrientedBoundingBoxErrorBound attribute: the extent of the
+   * pixels along each axis of the box exceeds the size by at most
+   * the bound. It is derived from the projection of the bounding box
+   * of the object, which contains all the skipped pixels. Defaults to
+   * 1, the exact box.
+   *
+   * Only the projection pass of this filter is decimated. The
+   * centroid and principal axes are still computed by the superclass
+   * from all the pixels, so the time saved is at most that of the
+   * projection pass.
+   */
+  itkSetClampMacro(DecimationFactor, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(DecimationFactor, unsigned int);
+
+  /** Set/Get whether the approximate boxes with an error bound
+   * larger than ApproximationTolerance along any axis are computed
+   * again from all the lines. Defaults to Off.
+   */
+  itkSetMacro(RefineApproximation, bool);
+  itkGetConstMacro(RefineApproximation, bool);
+  itkBooleanMacro(RefineApproximation);
+
+  /** Set/Get the largest error bound, in physical units, accepted
+   * for an approximate box when RefineApproximation is On. Defaults
+   * to 0.
+   */
+  itkSetMacro(ApproximationTolerance, double);
+  itkGetConstMacro(ApproximationTolerance, double);
 
 protected:
-  OrientedBoundingBoxLabelMapFilter() {};
+  OrientedBoundingBoxLabelMapFilter();
 
   virtual void ThreadedProcessLabelObject(LabelObjectType *labelObject) ITK_OVERRIDE;
 
   virtual void PrintSelf(std::ostream & os, Indent indent) const ITK_OVERRIDE;
 
+  /** Compute the box aligned with the principal axes. */
+  void ComputePrincipalAxesBoundingBox( LabelObjectType *labelObject );
+
+  /** Compute the bounds of every decimationFactor-th line, and the
+   * last one, projected with the affine map, including the pixel
+   * padding. */
+  void ComputeProjectionBounds( const LabelObjectType *labelObject,
+                                const MatrixType &indexToProjection,
+                                const VectorType &projectionOffset,
+                                unsigned int decimationFactor,
+                                VectorType &proj_min,
+                                VectorType &proj_max ) const;
+
+  /** Bound the error of projected bounds computed from a subset of the
+   * lines, with the projection of the corners of the bounding box of
+   * the label object. */
+  static VectorType ComputeErrorBound( const LabelObjectType *labelObject,
+                                       const MatrixType &indexToProjection,
+                                       const VectorType &projectionOffset,
+                                       const VectorType &proj_min,
+                                       const VectorType &proj_max );
+
+  /** Compute the box of a label object with few lines, aligned with
+   * the principal axes, serially. */
+  void ComputeSmallBoundingBox( LabelObjectType *labelObject );
+
+  /** Compute the exact box of a label object made of a single line,
+   * aligned with the image axes. */
+  void ComputeSingleLineBoundingBox( LabelObjectType *labelObject );
+
+  struct DispatchBase {};
+  template< unsigned int VDimension >
+  struct Dispatch : public DispatchBase {};
+
+  /** Compute the box of minimum area or volume. */
+  void ComputeMinimumVolumeBoundingBox( LabelObjectType *labelObject, const DispatchBase & );
+  void ComputeMinimumVolumeBoundingBox( LabelObjectType *labelObject, const Dispatch<2> & );
+  void ComputeMinimumVolumeBoundingBox( LabelObjectType *labelObject, const Dispatch<3> & );
+
+  typedef Vector<double, 2>           Vector2DType;
+  typedef std::vector< Vector2DType > Point2DContainer;
+
+  /** Orders lines by row, slowest index first, then by start. */
+  struct LineRowCompare
+  {
+    bool operator()( const LineType &a, const LineType &b ) const
+    {
+      for ( unsigned int i = ImageDimension - 1; i > 0; --i )
+        {
+        if ( a.GetIndex()[i] != b.GetIndex()[i] )
+          {
+          return a.GetIndex()[i] < b.GetIndex()[i];
+          }
+        }
+      return a.GetIndex()[0] < b.GetIndex()[0];
+    }
+
+    static bool SameRow( const LineType &a, const LineType &b )
+    {
+      for ( unsigned int i = 1; i < ImageDimension; ++i )
+        {
+        if ( a.GetIndex()[i] != b.GetIndex()[i] )
+          {
+          return false;
+          }
+        }
+      return true;
+    }
+  };
+
+  struct PointLexicographicCompare
+  {
+    bool operator()( const Vector2DType &a, const Vector2DType &b ) const
+    {
+      return a[0] < b[0] || ( a[0] == b[0] && a[1] < b[1] );
+    }
+  };
+
+  /** z component of the cross product of b-a and c-a, positive for
+   * a counter-clockwise turn. */
+  static inline double Cross( const Vector2DType &a, const Vector2DType &b, const Vector2DType &c )
+  {
+    return ( b[0] - a[0] ) * ( c[1] - a[1] ) - ( b[1] - a[1] ) * ( c[0] - a[0] );
+  }
+
+  /** Get the lines of the label object sorted by row, with the lines
+   * of each row merged into one line spanning the row. */
+  static void GetRowExtents( const LabelObjectType *labelObject, std::vector<LineType> &rows );
+
+  /** Append the corners, in continuous index space, of the first two
+   * dimensions of the pixels of a row. */
+  static void AppendRowCorners( const LineType &row, Point2DContainer &points );
+
+  /** Replace the points with their convex hull in counter-clockwise
+   * order. */
+  static void ConvexHull( Point2DContainer &points );
+
+  /** Find the minimum area rectangle enclosing a counter-clockwise
+   * convex polygon. The rectangle is aligned with axis and its
+   * normal, and its area is returned. */
+  static double MinimumAreaRectangle( const Point2DContainer &hull,
+                                      Vector2DType &axis,
+                                      Vector2DType &rect_min,
+                                      Vector2DType &rect_max );
+
+  /** Compute the box of the points with the unit vector a as its
+   * last axis, and the minimum area rectangle of the points projected
+   * onto the orthogonal plane. Returns the volume of the box, or a
+   * negative value when the projection is degenerate. */
+  static double AxisBoundingBox( const std::vector<VectorType> &points,
+                                 const VectorType &a,
+                                 Point2DContainer &projected,
+                                 MatrixType &rotationMatrix,
+                                 VectorType &proj_min,
+                                 VectorType &proj_max );
+
+  /** Pad the bounds of the pixel centers projected with the affine
+   * map indexToProjection to the extent of the pixels. */
+  static void PadByHalfPixel( const MatrixType &indexToProjection, VectorType &proj_min, VectorType &proj_max );
+
+  /** Reorder the rows of a rotation and the projected bounds by
+   * increasing extent, keeping the orientation of the rotation. */
+  static void SortAxesByExtent( MatrixType &rotationMatrix, VectorType &proj_min, VectorType &proj_max );
+
+  /** Expand the bounds in the projected domain to include both end
+   * points of an RLE line. The affine map indexToProjection,
+   * projectionOffset takes an index directly into the principal axes
+   * basis, so the end of the line is just the start plus (length-1)
+   * times the first column of the matrix. The loops have
+   * compile-time extents so they are fully unrolled for the 2D and
+   * 3D instantiations. */
+  static inline void ExpandByLine( const MatrixType &indexToProjection,
+                                   const VectorType &projectionOffset,
+                                   const LineType &line,
+                                   VectorType &proj_min,
+                                   VectorType &proj_max )
+  {
+    const IndexType & idx = line.GetIndex();
+    const double lastOffset = static_cast<double>( line.GetLength() - 1 );
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      double start = projectionOffset[i];
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+        start += indexToProjection(i,j) * idx[j];
+        }
+      const double end = start + lastOffset * indexToProjection(i,0);
+      proj_min[i] = std::min(proj_min[i], std::min(start, end));
+      proj_max[i] = std::max(proj_max[i], std::max(start, end));
+      }
+  }
+
+  /** Accumulates the bounds of the lines in the projected domain,
+   * for use with LabelObjectLineReducer. */
+  class ProjectionBoundsAccumulator
+  {
+  public:
+    ProjectionBoundsAccumulator( const MatrixType &indexToProjection,
+                                 const VectorType &projectionOffset )
+      : m_IndexToProjection( indexToProjection ),
+        m_ProjectionOffset( projectionOffset )
+    {
+      m_Min.Fill( NumericTraits<double>::max() );
+      m_Max.Fill( NumericTraits<double>::NonpositiveMin() );
+    }
+
+    void operator()( const LineType &line )
+    {
+      ExpandByLine( m_IndexToProjection, m_ProjectionOffset, line, m_Min, m_Max );
+    }
+
+    void Merge( const ProjectionBoundsAccumulator &other )
+    {
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        m_Min[i] = std::min( m_Min[i], other.m_Min[i] );
+        m_Max[i] = std::max( m_Max[i], other.m_Max[i] );
+        }
+    }
+
+    const VectorType & GetMinimum() const { return m_Min; }
+    const VectorType & GetMaximum() const { return m_Max; }
+
+  private:
+    MatrixType     m_IndexToProjection;
+    VectorType     m_ProjectionOffset;
+    VectorType     m_Min;
+    VectorType     m_Max;
+  };
+
+  /** Set the oriented bounding box attributes of the label object
+   * from the bounds of its extent projected onto the rows of
+   * rotationMatrix. */
+  void SetOrientedBoundingBox( LabelObjectType *labelObject,
+                               const MatrixType &rotationMatrix,
+                               const VectorType &proj_min,
+                               const VectorType &proj_max ) const;
+
 private:
   OrientedBoundingBoxLabelMapFilter(const Self &); //purposely not implemented
   void operator=(const Self &);      //purposely not implemented
 
+  SizeValueType m_SmallLabelObjectNumberOfLines;
+  bool          m_AlignSingleLinesWithImageAxes;
+  bool          m_ComputeMinimumVolume;
+  unsigned int  m_MinimumVolumeSearchDirections;
+  unsigned int  m_DecimationFactor;
+  bool          m_RefineApproximation;
+  double        m_ApproximationTolerance;
 };
 
 
@@ -19,10 +19,23 @@
 #define itkOrientedBoundingBoxLabelMapFilter_hxx
 
 #include "itkOrientedBoundingBoxLabelMapFilter.h"
+#include "vnl/vnl_det.h"
 
 namespace itk
 {
 
+template< class TImage, class TLabelImage >
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::OrientedBoundingBoxLabelMapFilter()
+  : m_SmallLabelObjectNumberOfLines( 16 ),
+    m_AlignSingleLinesWithImageAxes( false ),
+    m_ComputeMinimumVolume( false ),
+    m_MinimumVolumeSearchDirections( 32 ),
+    m_DecimationFactor( 1 ),
+    m_RefineApproximation( false ),
+    m_ApproximationTolerance( 0.0 )
+{
+}
 
 template< class TImage, class TLabelImage >
 void
@@ -31,97 +44,787 @@ OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
 {
   Superclass::ThreadedProcessLabelObject(labelObject);
 
+  const SizeValueType numLines = labelObject->GetNumberOfLines();
+  if ( numLines == 1 && m_AlignSingleLinesWithImageAxes )
+    {
+    // A single line is its own minimum volume box.
+    this->ComputeSingleLineBoundingBox( labelObject );
+    return;
+    }
+  if ( numLines < m_SmallLabelObjectNumberOfLines && !m_ComputeMinimumVolume )
+    {
+    this->ComputeSmallBoundingBox( labelObject );
+    return;
+    }
 
-  typedef vnl_matrix<double> VNLMatrixType;
-  typedef vnl_vector<double> VNLVectorType;
+  if ( m_ComputeMinimumVolume )
+    {
+    this->ComputeMinimumVolumeBoundingBox( labelObject, Dispatch<ImageDimension>() );
+    }
+  else
+    {
+    this->ComputePrincipalAxesBoundingBox( labelObject );
+    }
+}
 
-  // this method is slow :(
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputePrincipalAxesBoundingBox(LabelObjectType *labelObject)
+{
   const ImageType *            output = this->GetOutput();
 
-  VNLMatrixType rotationMatrix = labelObject->GetPrincipalAxes().GetVnlMatrix();
+  const MatrixType rotationMatrix = labelObject->GetPrincipalAxes();
   const typename LabelObjectType::CentroidType centroid = labelObject->GetCentroid();
-  const unsigned int numLines = labelObject->GetNumberOfLines();
 
-  // Create a matrix where the columns are the physical points of the
-  // start and end of each RLE line from the label map, relative to
-  // the centroid
-  VNLMatrixType pixelLocations( ImageDimension, labelObject->GetNumberOfLines()*2 );
-  for( unsigned int l = 0; l < numLines; ++l )
+  // Fuse the index to physical point transform and the projection
+  // onto the principal axes into one affine map, relative to the
+  // centroid, so that an index is taken straight into the projected
+  // domain with a single matrix-vector product.
+  const MatrixType indexToProjection = rotationMatrix * output->GetIndexToPhysicalPoint();
+  const VectorType projectionOffset = rotationMatrix * ( output->GetOrigin() - centroid );
+
+  VectorType proj_min;
+  VectorType proj_max;
+  this->ComputeProjectionBounds( labelObject, indexToProjection, projectionOffset, m_DecimationFactor, proj_min, proj_max );
+
+  VectorType errorBound;
+  errorBound.Fill( 0.0 );
+  if ( m_DecimationFactor > 1 )
     {
-    typename LabelObjectType::LineType line = labelObject->GetLine(l);
+    errorBound = ComputeErrorBound( labelObject, indexToProjection, projectionOffset, proj_min, proj_max );
 
-    // add start index of line as physical point relative to centroid
-    IndexType idx = line.GetIndex();
-    typename ImageType::PointType pt;
-    output->TransformIndexToPhysicalPoint(idx, pt);
-    for(unsigned int j = 0; j < ImageDimension; ++j)
+    bool refine = false;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
       {
-      pixelLocations(j,l*2) = pt[j] - centroid[j];
+      refine = refine || errorBound[i] > m_ApproximationTolerance;
       }
-
-    // add end index of line as physical point relative to centroid
-    idx[0] += line.GetLength() - 1;
-    output->TransformIndexToPhysicalPoint(idx, pt);
-    for(unsigned int j = 0; j < ImageDimension; ++j)
+    if ( m_RefineApproximation && refine )
       {
-      pixelLocations(j,l*2+1) = pt[j] - centroid[j];
+      this->ComputeProjectionBounds( labelObject, indexToProjection, projectionOffset, 1, proj_min, proj_max );
+      errorBound.Fill( 0.0 );
       }
     }
 
+  this->SetOrientedBoundingBox( labelObject, rotationMatrix, proj_min, proj_max );
+  labelObject->SetOrientedBoundingBoxErrorBound( errorBound );
+}
+
 
-  // Project the physical points onto principal axes
-  VNLMatrixType transformedPixelLocations = rotationMatrix * pixelLocations;
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputeProjectionBounds( const LabelObjectType *labelObject,
+                           const MatrixType &indexToProjection,
+                           const VectorType &projectionOffset,
+                           unsigned int decimationFactor,
+                           VectorType &proj_min,
+                           VectorType &proj_max ) const
+{
+  const SizeValueType numLines = labelObject->GetNumberOfLines();
 
-  // find the bounds in the projected domain
-  assert( transformedPixelLocations.columns() != 0 );
-  VNLVectorType proj_min = transformedPixelLocations.get_column(0);
-  VNLVectorType proj_max = transformedPixelLocations.get_column(0);
+  // Stream over the start and end of each RLE line from the label
+  // map. Each point is immediately reduced into the bounds in the
+  // projected domain, so no storage proportional to the number of
+  // lines is needed. Large objects are split across threads with
+  // each chunk of lines reduced separately.
+  assert( numLines != 0 );
+  ProjectionBoundsAccumulator bounds( indexToProjection, projectionOffset );
 
-  for ( unsigned int column = 1; column < transformedPixelLocations.columns(); column++ )
+  ThreadIdType numberOfThreads = 1;
+  const SizeValueType largeNumberOfLines = this->GetLargeLabelObjectNumberOfLines();
+  if ( largeNumberOfLines != 0 && numLines >= largeNumberOfLines * decimationFactor )
     {
+    numberOfThreads = this->GetNumberOfThreads();
+    }
+  LabelObjectLineReducer<LabelObjectType, ProjectionBoundsAccumulator>::Reduce( labelObject, bounds,
+                                                                               this->GetLabelObjectScheduler(),
+                                                                               numberOfThreads,
+                                                                               decimationFactor );
+
+  proj_min = bounds.GetMinimum();
+  proj_max = bounds.GetMaximum();
+
+  PadByHalfPixel( indexToProjection, proj_min, proj_max );
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::PadByHalfPixel( const MatrixType &indexToProjection, VectorType &proj_min, VectorType &proj_max )
+{
+  // The proj_min/max is from center of pixel to center of pixel. The
+  // full extent of the pixels needs to include the offset bits to the
+  // corners, projected onto the principle axis basis. Half a pixel in
+  // index space taken through the fused map is the same as the
+  // physical half pixel offset projected onto the rotation.
+  VectorType halfPixel;
+  halfPixel.Fill( 0.5 );
+  const VectorType proj_offset = indexToProjection * halfPixel;
+
+  proj_min -= proj_offset;
+  proj_max += proj_offset;
+}
+
+
+template< class TImage, class TLabelImage >
+typename OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >::VectorType
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputeErrorBound( const LabelObjectType *labelObject,
+                     const MatrixType &indexToProjection,
+                     const VectorType &projectionOffset,
+                     const VectorType &proj_min,
+                     const VectorType &proj_max )
+{
+  // Every pixel, skipped or not, is inside the bounding box of the
+  // label object, so the projected extent of the pixels is inside the
+  // projected extent of the corners of the bounding box.
+  const typename LabelObjectType::RegionType & boundingBox = labelObject->GetBoundingBox();
+
+  VectorType corner_min;
+  VectorType corner_max;
+  corner_min.Fill( NumericTraits<double>::max() );
+  corner_max.Fill( NumericTraits<double>::NonpositiveMin() );
+
+  for ( unsigned int c = 0; c < ( 1u << ImageDimension ); ++c )
+    {
+    VectorType cidx;
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      cidx[j] = boundingBox.GetIndex()[j] - 0.5;
+      if ( c & ( 1u << j ) )
+        {
+        cidx[j] += boundingBox.GetSize()[j];
+        }
+      }
+    const VectorType p = indexToProjection * cidx + projectionOffset;
     for ( unsigned int i = 0; i < ImageDimension; ++i )
       {
-      const double value = transformedPixelLocations(i, column);
-      proj_min[i] = std::min(proj_min[i], value);
-      proj_max[i] = std::max(proj_max[i], value);
+      corner_min[i] = std::min( corner_min[i], p[i] );
+      corner_max[i] = std::max( corner_max[i], p[i] );
       }
     }
 
-  // The proj_min/max is from center of pixel to center of pixel. The
-  // full extent of the pixels needs to include the offset bits to the
-  // corners, projected onto the principle axis basis (rotationMatrix).
-  const Vector<double, ImageDimension> gridOffset = 0.5*output->GetSpacing();
-  Vector<double, ImageDimension> physicalOffset;
-  output->TransformLocalVectorToPhysicalVector(gridOffset, physicalOffset);
-  VNLVectorType proj_offset = rotationMatrix * physicalOffset.GetVnlVector();
+  VectorType errorBound;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    errorBound[i] = std::max( 0.0, corner_max[i] - proj_max[i] ) + std::max( 0.0, proj_min[i] - corner_min[i] );
+    }
+  return errorBound;
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputeSmallBoundingBox(LabelObjectType *labelObject)
+{
+  const ImageType *output = this->GetOutput();
+
+  const MatrixType & rotationMatrix = labelObject->GetPrincipalAxes();
+  const MatrixType indexToProjection = rotationMatrix * output->GetIndexToPhysicalPoint();
+  const VectorType projectionOffset = rotationMatrix * ( output->GetOrigin() - labelObject->GetCentroid() );
+
+  // same as the general path, without the accumulator and the thread
+  // dispatch
+  VectorType proj_min;
+  VectorType proj_max;
+  proj_min.Fill( NumericTraits<double>::max() );
+  proj_max.Fill( NumericTraits<double>::NonpositiveMin() );
+
+  const SizeValueType numLines = labelObject->GetNumberOfLines();
+  for ( SizeValueType l = 0; l < numLines; ++l )
+    {
+    ExpandByLine( indexToProjection, projectionOffset, labelObject->GetLine(l), proj_min, proj_max );
+    }
+
+  PadByHalfPixel( indexToProjection, proj_min, proj_max );
+
+  this->SetOrientedBoundingBox( labelObject, rotationMatrix, proj_min, proj_max );
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputeSingleLineBoundingBox(LabelObjectType *labelObject)
+{
+  const ImageType *output = this->GetOutput();
+
+  // The pixels of a line form a box aligned with the image axes,
+  // centered on the centroid, of one pixel in every direction but the
+  // first. The moments of a line, and of a single pixel, are repeated
+  // so the principal axes are arbitrary across the line and would
+  // give a larger box in general.
+  const typename ImageType::DirectionType & direction = output->GetDirection();
+  const typename ImageType::SpacingType & spacing = output->GetSpacing();
+
+  MatrixType rotationMatrix;
+  VectorType proj_max;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      rotationMatrix(i,j) = direction(j,i);
+      }
+    proj_max[i] = 0.5 * spacing[i];
+    }
+  proj_max[0] *= labelObject->GetLine(0).GetLength();
+
+  // keep a proper rotation, the bounds are symmetric
+  if ( vnl_det( direction.GetVnlMatrix() ) < 0.0 )
+    {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      rotationMatrix(ImageDimension - 1, j) = -rotationMatrix(ImageDimension - 1, j);
+      }
+    }
+
+  VectorType proj_min = -proj_max;
+
+  SortAxesByExtent( rotationMatrix, proj_min, proj_max );
+  this->SetOrientedBoundingBox( labelObject, rotationMatrix, proj_min, proj_max );
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputeMinimumVolumeBoundingBox( LabelObjectType *labelObject, const DispatchBase & )
+{
+  // Only 2D and 3D are supported, use the principal axes otherwise.
+  this->ComputePrincipalAxesBoundingBox( labelObject );
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputeMinimumVolumeBoundingBox( LabelObjectType *labelObject, const Dispatch<2> & )
+{
+  const ImageType *output = this->GetOutput();
+  const MatrixType &indexToPhysical = output->GetIndexToPhysicalPoint();
+  const VectorType originOffset = output->GetOrigin() - labelObject->GetCentroid();
+
+  std::vector<LineType> rows;
+  GetRowExtents( labelObject, rows );
+
+  // The hull of the corners of the row extents is computed in index
+  // space, which is much cheaper than working with all the lines.
+  Point2DContainer hull;
+  hull.reserve( 4*rows.size() );
+  for ( size_t r = 0; r < rows.size(); ++r )
+    {
+    AppendRowCorners( rows[r], hull );
+    }
+  ConvexHull( hull );
+
+  // Convexity is kept by the affine map to physical space relative to
+  // the centroid, but a negative determinant flips the orientation,
+  // so the few remaining points are hulled again.
+  for ( size_t i = 0; i < hull.size(); ++i )
+    {
+    VectorType cidx;
+    cidx[0] = hull[i][0];
+    cidx[1] = hull[i][1];
+    const VectorType pt = indexToPhysical * cidx + originOffset;
+    hull[i][0] = pt[0];
+    hull[i][1] = pt[1];
+    }
+  ConvexHull( hull );
+
+  if ( hull.size() < 3 )
+    {
+    this->ComputePrincipalAxesBoundingBox( labelObject );
+    return;
+    }
+
+  Vector2DType axis;
+  Vector2DType rect_min;
+  Vector2DType rect_max;
+  MinimumAreaRectangle( hull, axis, rect_min, rect_max );
+
+  MatrixType rotationMatrix;
+  rotationMatrix(0,0) = axis[0];
+  rotationMatrix(0,1) = axis[1];
+  rotationMatrix(1,0) = -axis[1];
+  rotationMatrix(1,1) = axis[0];
+
+  VectorType proj_min;
+  VectorType proj_max;
+  for ( unsigned int i = 0; i < 2; ++i )
+    {
+    proj_min[i] = rect_min[i];
+    proj_max[i] = rect_max[i];
+    }
+
+  SortAxesByExtent( rotationMatrix, proj_min, proj_max );
+  this->SetOrientedBoundingBox( labelObject, rotationMatrix, proj_min, proj_max );
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ComputeMinimumVolumeBoundingBox( LabelObjectType *labelObject, const Dispatch<3> & )
+{
+  const ImageType *output = this->GetOutput();
+  const MatrixType &indexToPhysical = output->GetIndexToPhysicalPoint();
+  const VectorType originOffset = output->GetOrigin() - labelObject->GetCentroid();
+
+  std::vector<LineType> rows;
+  GetRowExtents( labelObject, rows );
+
+  // Reduce the object to the vertices of the convex hull of each
+  // slice, lifted to the two faces of the slice. Every vertex of the
+  // 3D convex hull of the pixels is one of these points.
+  std::vector<VectorType> points;
+  Point2DContainer        sliceHull;
+  size_t r = 0;
+  while ( r < rows.size() )
+    {
+    const IndexValueType z = rows[r].GetIndex()[2];
+
+    sliceHull.clear();
+    for ( ; r < rows.size() && rows[r].GetIndex()[2] == z; ++r )
+      {
+      AppendRowCorners( rows[r], sliceHull );
+      }
+    ConvexHull( sliceHull );
+
+    for ( size_t i = 0; i < sliceHull.size(); ++i )
+      {
+      VectorType cidx;
+      cidx[0] = sliceHull[i][0];
+      cidx[1] = sliceHull[i][1];
+      cidx[2] = z - 0.5;
+      points.push_back( indexToPhysical * cidx + originOffset );
+      cidx[2] = z + 0.5;
+      points.push_back( indexToPhysical * cidx + originOffset );
+      }
+    }
+
+  // Candidate directions for one of the box axes: the principal axes,
+  // the image axes and optionally directions spread uniformly over
+  // the hemisphere. For each candidate the minimum area rectangle of
+  // the points projected onto the orthogonal plane is found.
+  std::vector<VectorType> candidates;
+  const MatrixType principalAxes = labelObject->GetPrincipalAxes();
+  const typename ImageType::DirectionType & direction = output->GetDirection();
+  for ( unsigned int i = 0; i < 3; ++i )
+    {
+    VectorType a;
+    VectorType d;
+    for ( unsigned int j = 0; j < 3; ++j )
+      {
+      a[j] = principalAxes(i,j);
+      d[j] = direction(j,i);
+      }
+    candidates.push_back( a );
+    candidates.push_back( d );
+    }
+
+  const double goldenAngle = vnl_math::pi * ( 3.0 - std::sqrt( 5.0 ) );
+  for ( unsigned int k = 0; k < m_MinimumVolumeSearchDirections; ++k )
+    {
+    const double z = 1.0 - ( k + 0.5 ) / m_MinimumVolumeSearchDirections;
+    const double radius = std::sqrt( 1.0 - z*z );
+    const double phi = k * goldenAngle;
+    VectorType a;
+    a[0] = radius * std::cos( phi );
+    a[1] = radius * std::sin( phi );
+    a[2] = z;
+    candidates.push_back( a );
+    }
+
+  double     bestVolume = NumericTraits<double>::max();
+  MatrixType rotationMatrix;
+  VectorType proj_min;
+  VectorType proj_max;
 
+  Point2DContainer projected;
+  projected.reserve( points.size() );
+
+  MatrixType candidateRotation;
+  VectorType candidate_min;
+  VectorType candidate_max;
+  for ( size_t c = 0; c < candidates.size(); ++c )
+    {
+    VectorType a = candidates[c];
+    const double norm = a.GetNorm();
+    if ( norm == 0.0 )
+      {
+      continue;
+      }
+    a /= norm;
+
+    const double volume = AxisBoundingBox( points, a, projected, candidateRotation, candidate_min, candidate_max );
+    if ( volume >= 0.0 && volume < bestVolume )
+      {
+      bestVolume = volume;
+      rotationMatrix = candidateRotation;
+      proj_min = candidate_min;
+      proj_max = candidate_max;
+      }
+    }
+
+  if ( bestVolume == NumericTraits<double>::max() )
+    {
+    this->ComputePrincipalAxesBoundingBox( labelObject );
+    return;
+    }
+
+  // The candidates are a coarse sampling of the directions, so the
+  // axis of the best one is refined by a local search: it is tilted
+  // towards the two other axes of its box while the volume decreases,
+  // with a step starting at about half the spacing of the candidates
+  // and halved down to a thousandth of a radian.
+  double step = 0.5 * std::sqrt( 2.0 * vnl_math::pi / candidates.size() );
+  while ( step > 1e-3 )
+    {
+    bool improved = false;
+    for ( unsigned int n = 0; n < 4 && !improved; ++n )
+      {
+      VectorType a;
+      const double sign = ( n % 2 == 0 ) ? 1.0 : -1.0;
+      for ( unsigned int j = 0; j < 3; ++j )
+        {
+        a[j] = std::cos( step ) * rotationMatrix(2,j) + sign * std::sin( step ) * rotationMatrix(n/2,j);
+        }
+      a.Normalize();
+
+      const double volume = AxisBoundingBox( points, a, projected, candidateRotation, candidate_min, candidate_max );
+      if ( volume >= 0.0 && volume < bestVolume )
+        {
+        bestVolume = volume;
+        rotationMatrix = candidateRotation;
+        proj_min = candidate_min;
+        proj_max = candidate_max;
+        improved = true;
+        }
+      }
+    if ( !improved )
+      {
+      step *= 0.5;
+      }
+    }
+
+  SortAxesByExtent( rotationMatrix, proj_min, proj_max );
+  this->SetOrientedBoundingBox( labelObject, rotationMatrix, proj_min, proj_max );
+}
+
+
+template< class TImage, class TLabelImage >
+double
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::AxisBoundingBox( const std::vector<VectorType> &points,
+                   const VectorType &a,
+                   Point2DContainer &projected,
+                   MatrixType &rotationMatrix,
+                   VectorType &proj_min,
+                   VectorType &proj_max )
+{
+  // orthonormal right-handed basis ( b1, b2, a )
+  unsigned int smallest = 0;
+  for ( unsigned int j = 1; j < 3; ++j )
+    {
+    if ( std::abs( a[j] ) < std::abs( a[smallest] ) )
+      {
+      smallest = j;
+      }
+    }
+  VectorType helper;
+  helper.Fill( 0.0 );
+  helper[smallest] = 1.0;
+  VectorType b1 = CrossProduct( a, helper );
+  b1.Normalize();
+  const VectorType b2 = CrossProduct( a, b1 );
+
+  double height_min = NumericTraits<double>::max();
+  double height_max = NumericTraits<double>::NonpositiveMin();
+
+  projected.clear();
+  for ( size_t i = 0; i < points.size(); ++i )
+    {
+    Vector2DType p;
+    p[0] = b1 * points[i];
+    p[1] = b2 * points[i];
+    projected.push_back( p );
+
+    const double h = a * points[i];
+    height_min = std::min( height_min, h );
+    height_max = std::max( height_max, h );
+    }
+  ConvexHull( projected );
+
+  if ( projected.size() < 3 )
+    {
+    return -1.0;
+    }
+
+  Vector2DType axis;
+  Vector2DType rect_min;
+  Vector2DType rect_max;
+  const double area = MinimumAreaRectangle( projected, axis, rect_min, rect_max );
+
+  const VectorType u = axis[0] * b1 + axis[1] * b2;
+  const VectorType v = -axis[1] * b1 + axis[0] * b2;
+  for ( unsigned int j = 0; j < 3; ++j )
+    {
+    rotationMatrix(0,j) = u[j];
+    rotationMatrix(1,j) = v[j];
+    rotationMatrix(2,j) = a[j];
+    }
+  proj_min[0] = rect_min[0];
+  proj_max[0] = rect_max[0];
+  proj_min[1] = rect_min[1];
+  proj_max[1] = rect_max[1];
+  proj_min[2] = height_min;
+  proj_max[2] = height_max;
+
+  return area * ( height_max - height_min );
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::GetRowExtents( const LabelObjectType *labelObject, std::vector<LineType> &rows )
+{
+  const SizeValueType numLines = labelObject->GetNumberOfLines();
+
+  rows.clear();
+  rows.reserve( numLines );
+  for ( SizeValueType l = 0; l < numLines; ++l )
+    {
+    rows.push_back( labelObject->GetLine(l) );
+    }
+  std::sort( rows.begin(), rows.end(), LineRowCompare() );
+
+  // merge the lines of each row into one line spanning the extent of
+  // the row
+  size_t last = 0;
+  for ( size_t l = 1; l < rows.size(); ++l )
+    {
+    if ( LineRowCompare::SameRow( rows[last], rows[l] ) )
+      {
+      const IndexValueType end = std::max( rows[last].GetIndex()[0] + static_cast<IndexValueType>( rows[last].GetLength() ),
+                                            rows[l].GetIndex()[0] + static_cast<IndexValueType>( rows[l].GetLength() ) );
+      rows[last].SetLength( end - rows[last].GetIndex()[0] );
+      }
+    else
+      {
+      rows[++last] = rows[l];
+      }
+    }
+  if ( !rows.empty() )
+    {
+    rows.resize( last + 1 );
+    }
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::AppendRowCorners( const LineType &row, Point2DContainer &points )
+{
+  const double x0 = row.GetIndex()[0] - 0.5;
+  const double x1 = row.GetIndex()[0] + row.GetLength() - 0.5;
+  const double y = row.GetIndex()[1];
+
+  Vector2DType p;
+  p[0] = x0; p[1] = y - 0.5;
+  points.push_back( p );
+  p[0] = x1;
+  points.push_back( p );
+  p[1] = y + 0.5;
+  points.push_back( p );
+  p[0] = x0;
+  points.push_back( p );
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::ConvexHull( Point2DContainer &points )
+{
+  // Andrew's monotone chain, collinear points are removed and the
+  // hull is returned in counter-clockwise order.
+  const size_t n = points.size();
+  if ( n < 3 )
+    {
+    return;
+    }
+
+  std::sort( points.begin(), points.end(), PointLexicographicCompare() );
+
+  Point2DContainer hull( 2*n );
+  size_t k = 0;
+  for ( size_t i = 0; i < n; ++i )
+    {
+    while ( k >= 2 && Cross( hull[k-2], hull[k-1], points[i] ) <= 0.0 )
+      {
+      --k;
+      }
+    hull[k++] = points[i];
+    }
+  for ( size_t i = n - 1, t = k + 1; i > 0; --i )
+    {
+    while ( k >= t && Cross( hull[k-2], hull[k-1], points[i-1] ) <= 0.0 )
+      {
+      --k;
+      }
+    hull[k++] = points[i-1];
+    }
+
+  // the last point is the same as the first
+  hull.resize( k - 1 );
+  points.swap( hull );
+}
+
+
+template< class TImage, class TLabelImage >
+double
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::MinimumAreaRectangle( const Point2DContainer &hull,
+                        Vector2DType &axis,
+                        Vector2DType &rect_min,
+                        Vector2DType &rect_max )
+{
+  // Rotating calipers: the minimum area rectangle has a side
+  // collinear with an edge of the convex hull. Walking the edges in
+  // counter-clockwise order, the points of maximum extent along the
+  // edge (right), along its inward normal (top) and of minimum extent
+  // along the edge (left) only ever advance, so all the edges are
+  // evaluated in linear time.
+  const size_t n = hull.size();
+  assert( n >= 3 );
+
+  double bestArea = NumericTraits<double>::max();
+
+  size_t right = 1;
+  size_t top = 1;
+  size_t left = 1;
+
+  for ( size_t i = 0; i < n; ++i )
+    {
+    Vector2DType e = hull[(i+1)%n] - hull[i];
+    e.Normalize();
+    Vector2DType normal;
+    normal[0] = -e[1];
+    normal[1] = e[0];
+
+    size_t steps = 0;
+    if ( i == 0 )
+      {
+      right = 1;
+      }
+    while ( steps++ < n && ( hull[(right+1)%n] - hull[right] ) * e > 0.0 )
+      {
+      right = (right+1)%n;
+      }
+
+    if ( i == 0 )
+      {
+      top = right;
+      }
+    steps = 0;
+    while ( steps++ < n && ( hull[(top+1)%n] - hull[top] ) * normal > 0.0 )
+      {
+      top = (top+1)%n;
+      }
+
+    if ( i == 0 )
+      {
+      left = top;
+      }
+    steps = 0;
+    while ( steps++ < n && ( hull[(left+1)%n] - hull[left] ) * e < 0.0 )
+      {
+      left = (left+1)%n;
+      }
+
+    const double e_min = e * hull[left];
+    const double e_max = e * hull[right];
+    const double n_min = normal * hull[i];
+    const double n_max = normal * hull[top];
+
+    const double area = ( e_max - e_min ) * ( n_max - n_min );
+    if ( area < bestArea )
+      {
+      bestArea = area;
+      axis = e;
+      rect_min[0] = e_min;
+      rect_max[0] = e_max;
+      rect_min[1] = n_min;
+      rect_max[1] = n_max;
+      }
+    }
+
+  return bestArea;
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::SortAxesByExtent( MatrixType &rotationMatrix, VectorType &proj_min, VectorType &proj_max )
+{
+  // Order the axes by increasing extent, as the principal axes are
+  // ordered by increasing principal moment. Each exchange of two rows
+  // also negates one of them to preserve the orientation.
   for ( unsigned int i = 0; i < ImageDimension; ++i )
     {
-    proj_min[i] -= proj_offset[i];
-    proj_max[i] += proj_offset[i];
+    for ( unsigned int j = ImageDimension - 1; j > i; --j )
+      {
+      if ( proj_max[j] - proj_min[j] < proj_max[j-1] - proj_min[j-1] )
+        {
+        for ( unsigned int k = 0; k < ImageDimension; ++k )
+          {
+          const double t = rotationMatrix(j,k);
+          rotationMatrix(j,k) = -rotationMatrix(j-1,k);
+          rotationMatrix(j-1,k) = t;
+          }
+        const double t_min = proj_min[j];
+        const double t_max = proj_max[j];
+        proj_min[j] = -proj_max[j-1];
+        proj_max[j] = -proj_min[j-1];
+        proj_min[j-1] = t_min;
+        proj_max[j-1] = t_max;
+        }
+      }
     }
+}
+
+
+template< class TImage, class TLabelImage >
+void
+OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
+::SetOrientedBoundingBox( LabelObjectType *labelObject,
+                          const MatrixType &rotationMatrix,
+                          const VectorType &proj_min,
+                          const VectorType &proj_max ) const
+{
+  const typename LabelObjectType::CentroidType centroid = labelObject->GetCentroid();
 
-  Vector<double, ImageDimension> rsize; // real physical size
+  VectorType rsize; // real physical size
   for ( unsigned int i = 0; i < ImageDimension; ++i )
     {
     rsize[i] = vnl_math_abs(proj_max[i]-proj_min[i]);
     }
 
-
   //
   // Invert rotation matrix, we will now convert points from the
   // projected space back to the physical one
   //
-  rotationMatrix.inplace_transpose();
+  const MatrixType direction( rotationMatrix.GetTranspose() );
 
-  VNLVectorType min = rotationMatrix*proj_min;
-  VNLVectorType max = rotationMatrix*proj_max;
-
-  for ( unsigned int i = 0; i < ImageDimension; ++i )
-    {
-    min[i] += centroid[i];
-    max[i] += centroid[i];
-    }
+  const typename LabelObjectType::CentroidType min = centroid + direction*proj_min;
+  const typename LabelObjectType::CentroidType max = centroid + direction*proj_max;
 
   typename LabelObjectType::OBBVerticesType vertices;
 
@@ -148,8 +851,11 @@ OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
 
   labelObject->SetOrientedBoundingBoxVertices(vertices);
   labelObject->SetOrientedBoundingBoxSize(rsize);
-  labelObject->SetOrientedBoundingBoxDirection( rotationMatrix );
+  labelObject->SetOrientedBoundingBoxDirection(direction);
 
+  VectorType errorBound;
+  errorBound.Fill( 0.0 );
+  labelObject->SetOrientedBoundingBoxErrorBound(errorBound);
 }
 
 template< class TImage, class TLabelImage >
@@ -158,6 +864,14 @@ OrientedBoundingBoxLabelMapFilter< TImage, TLabelImage >
 ::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
+
+  os << indent << "SmallLabelObjectNumberOfLines: " << m_SmallLabelObjectNumberOfLines << std::endl;
+  os << indent << "AlignSingleLinesWithImageAxes: " << m_AlignSingleLinesWithImageAxes << std::endl;
+  os << indent << "ComputeMinimumVolume: " << m_ComputeMinimumVolume << std::endl;
+  os << indent << "MinimumVolumeSearchDirections: " << m_MinimumVolumeSearchDirections << std::endl;
+  os << indent << "DecimationFactor: " << m_DecimationFactor << std::endl;
+  os << indent << "RefineApproximation: " << m_RefineApproximation << std::endl;
+  os << indent << "ApproximationTolerance: " << m_ApproximationTolerance << std::endl;
 }
 
 } // end namespace itk
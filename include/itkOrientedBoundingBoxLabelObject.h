@@ -126,6 +126,23 @@ public:
     return m_OBBSize;
   }
 
+  /** The maximum amount by which the extent of the label object along
+   * each axis of the box may exceed OrientedBoundingBoxSize, when the
+   * box is computed from a subset of the lines. Zero for an exact
+   * box. */
+  void SetOrientedBoundingBoxErrorBound( const OBBSizeType &d )
+  {
+    m_OBBErrorBound = d;
+  }
+  const OBBSizeType & GetOrientedBoundingBoxErrorBound() const
+  {
+      return m_OBBErrorBound;
+  }
+  OBBSizeType GetOrientedBoundingBoxErrorBound()
+  {
+    return m_OBBErrorBound;
+  }
+
 
   virtual void CopyAttributesFrom( const LabelObjectType * lo ) ITK_OVERRIDE
     {
@@ -140,12 +157,14 @@ public:
     this->m_OBBVertices = src->m_OBBVertices;
     this->m_OBBDirection = src->m_OBBDirection;
     this->m_OBBSize = src->m_OBBSize;
+    this->m_OBBErrorBound = src->m_OBBErrorBound;
     }
 
 protected:
   OrientedBoundingBoxLabelObject()
     {
     // how to initialize the attribute ?
+    m_OBBErrorBound.Fill( 0.0 );
     }
 
 
@@ -157,6 +176,7 @@ protected:
     os << indent << "OBBVertices: " << m_OBBVertices << std::endl;
     os << indent << "OBBDirection: " << m_OBBDirection; // prints eol
     os << indent << "OBBSize: " << m_OBBSize << std::endl;
+    os << indent << "OBBErrorBound: " << m_OBBErrorBound << std::endl;
     }
 
 
@@ -170,6 +190,8 @@ private:
 
   OBBSizeType m_OBBSize;
 
+  OBBSizeType m_OBBErrorBound;
+
   OBBVerticesType m_OBBVertices;
 };
 
@@ -0,0 +1,200 @@
+ /*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPrincipalMomentsLabelMapFilter_h
+#define itkPrincipalMomentsLabelMapFilter_h
+
+#include "itkInPlaceLabelMapFilter.h"
+#include "itkScheduledLabelMapFilter.h"
+#include "itkLabelObjectLineReducer.h"
+
+namespace itk
+{
+
+/** \class PrincipalMomentsLabelMapFilter
+ * \brief Computes only the shape attributes needed for the oriented
+ * bounding box.
+ *
+ * This filter is a lean replacement for ShapeLabelMapFilter as the
+ * superclass of OrientedBoundingBoxLabelMapFilter and
+ * BoundingBoxImageLabelMapFilter. Only the number of pixels, the
+ * physical size, the bounding box, the centroid, the principal
+ * moments and the principal axes of the label objects are computed;
+ * the perimeter, Feret diameter, border and other attributes are
+ * left untouched.
+ *
+ * The moments are accumulated from the RLE lines in closed form,
+ * without visiting each pixel. The sums of the index and of its
+ * products over the pixels of a line only depend on the start and
+ * length of the line. They are accumulated in index space relative
+ * to the first line of the object, and mapped to physical space once
+ * per object. As in ShapeLabelMapFilter, the second order moment of a
+ * pixel, spacing[i]^2/12, is added to the diagonal of the central
+ * moments, so the results are the same as those of
+ * ShapeLabelMapFilter.
+ *
+ * The lines of a label object with at least
+ * LargeLabelObjectNumberOfLines lines are partitioned into chunks
+ * shared with the idle threads of the filter, see
+ * ScheduledLabelMapFilter. When this filter is the superclass of a
+ * ScheduledLabelMapFilter, the chunks are shared with the threads of
+ * the subclass.
+ *
+ * The label object type must provide the attributes of
+ * ShapeLabelObject.
+ *
+ * \ingroup ITKLabelMap
+ * \ingroup ITKOBBLabelMap
+ */
+template< class TImage >
+class PrincipalMomentsLabelMapFilter:
+  public ScheduledLabelMapFilter< InPlaceLabelMapFilter< TImage > >
+{
+public:
+  /** Standard class typedefs. */
+  typedef PrincipalMomentsLabelMapFilter                             Self;
+  typedef ScheduledLabelMapFilter< InPlaceLabelMapFilter< TImage > > Superclass;
+  typedef SmartPointer< Self >                                       Pointer;
+  typedef SmartPointer< const Self >                                 ConstPointer;
+
+  /** Some convenient typedefs. */
+  typedef TImage                               ImageType;
+  typedef typename ImageType::Pointer          ImagePointer;
+  typedef typename ImageType::ConstPointer     ImageConstPointer;
+  typedef typename ImageType::PixelType        PixelType;
+  typedef typename ImageType::IndexType        IndexType;
+  typedef typename ImageType::SizeType         SizeType;
+  typedef typename ImageType::RegionType       RegionType;
+  typedef typename ImageType::LabelObjectType  LabelObjectType;
+  typedef typename LabelObjectType::LineType   LineType;
+
+  typedef typename LabelObjectType::MatrixType   MatrixType;
+  typedef typename LabelObjectType::VectorType   VectorType;
+  typedef typename LabelObjectType::CentroidType CentroidType;
+
+  /** ImageDimension constants */
+  itkStaticConstMacro(ImageDimension, unsigned int, TImage::ImageDimension);
+
+  /** Standard New method. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PrincipalMomentsLabelMapFilter, ScheduledLabelMapFilter);
+
+protected:
+  PrincipalMomentsLabelMapFilter();
+  ~PrincipalMomentsLabelMapFilter() {}
+
+  virtual void ThreadedProcessLabelObject(LabelObjectType *labelObject) ITK_OVERRIDE;
+
+  /** Accumulates the zeroth, first and second order moments of the
+   * indexes of the lines, relative to a reference index, and their
+   * bounds, for use with LabelObjectLineReducer. */
+  class MomentsAccumulator
+  {
+  public:
+    MomentsAccumulator( const IndexType &reference )
+      : m_Reference( reference ),
+        m_NumberOfPixels( 0 )
+    {
+      m_Sum.Fill( 0.0 );
+      m_SumOfProducts.Fill( 0.0 );
+      m_Min.Fill( NumericTraits<IndexValueType>::max() );
+      m_Max.Fill( NumericTraits<IndexValueType>::NonpositiveMin() );
+    }
+
+    void operator()( const LineType &line )
+    {
+      const IndexType & idx = line.GetIndex();
+      const SizeValueType length = line.GetLength();
+
+      // The pixels of the line are d + k*e0 for k in [0,n), so the sums
+      // only need n, sum(k) and sum(k^2).
+      const double n = static_cast<double>( length );
+      const double s1 = 0.5 * n * ( n - 1.0 );
+      const double s2 = ( n - 1.0 ) * n * ( 2.0 * n - 1.0 ) / 6.0;
+
+      VectorType d;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        d[i] = static_cast<double>( idx[i] - m_Reference[i] );
+        m_Sum[i] += n * d[i];
+        }
+      m_Sum[0] += s1;
+
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        for ( unsigned int j = 0; j < ImageDimension; ++j )
+          {
+          m_SumOfProducts(i,j) += n * d[i] * d[j];
+          }
+        m_SumOfProducts(0,i) += s1 * d[i];
+        m_SumOfProducts(i,0) += s1 * d[i];
+        }
+      m_SumOfProducts(0,0) += s2;
+
+      m_NumberOfPixels += length;
+
+      m_Min[0] = std::min( m_Min[0], idx[0] );
+      m_Max[0] = std::max( m_Max[0], idx[0] + static_cast<IndexValueType>( length ) - 1 );
+      for ( unsigned int i = 1; i < ImageDimension; ++i )
+        {
+        m_Min[i] = std::min( m_Min[i], idx[i] );
+        m_Max[i] = std::max( m_Max[i], idx[i] );
+        }
+    }
+
+    void Merge( const MomentsAccumulator &other )
+    {
+      m_NumberOfPixels += other.m_NumberOfPixels;
+      m_Sum += other.m_Sum;
+      m_SumOfProducts += other.m_SumOfProducts;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        m_Min[i] = std::min( m_Min[i], other.m_Min[i] );
+        m_Max[i] = std::max( m_Max[i], other.m_Max[i] );
+        }
+    }
+
+    const IndexType & GetReference() const { return m_Reference; }
+    SizeValueType GetNumberOfPixels() const { return m_NumberOfPixels; }
+    const VectorType & GetSum() const { return m_Sum; }
+    const MatrixType & GetSumOfProducts() const { return m_SumOfProducts; }
+    const IndexType & GetMinimum() const { return m_Min; }
+    const IndexType & GetMaximum() const { return m_Max; }
+
+  private:
+    IndexType     m_Reference;
+    SizeValueType m_NumberOfPixels;
+    VectorType    m_Sum;
+    MatrixType    m_SumOfProducts;
+    IndexType     m_Min;
+    IndexType     m_Max;
+  };
+
+private:
+  PrincipalMomentsLabelMapFilter(const Self &); //purposely not implemented
+  void operator=(const Self &);                 //purposely not implemented
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkPrincipalMomentsLabelMapFilter.hxx"
+#endif
+
+#endif // itkPrincipalMomentsLabelMapFilter_h
@@ -0,0 +1,119 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPrincipalMomentsLabelMapFilter_hxx
+#define itkPrincipalMomentsLabelMapFilter_hxx
+
+#include "itkPrincipalMomentsLabelMapFilter.h"
+#include "itkSmallSymmetricEigenSystem.h"
+
+namespace itk
+{
+
+template< class TImage >
+PrincipalMomentsLabelMapFilter< TImage >
+::PrincipalMomentsLabelMapFilter()
+{
+}
+
+
+template< class TImage >
+void
+PrincipalMomentsLabelMapFilter< TImage >
+::ThreadedProcessLabelObject(LabelObjectType *labelObject)
+{
+  const ImageType *output = this->GetOutput();
+
+  const SizeValueType numLines = labelObject->GetNumberOfLines();
+  assert( numLines != 0 );
+
+  MomentsAccumulator moments( labelObject->GetLine(0).GetIndex() );
+
+  ThreadIdType numberOfThreads = 1;
+  const SizeValueType largeNumberOfLines = this->GetLargeLabelObjectNumberOfLines();
+  if ( largeNumberOfLines != 0 && numLines >= largeNumberOfLines )
+    {
+    numberOfThreads = this->GetNumberOfThreads();
+    }
+  LabelObjectLineReducer<LabelObjectType, MomentsAccumulator>::Reduce( labelObject, moments,
+                                                                      this->GetLabelObjectScheduler(),
+                                                                      numberOfThreads );
+
+  const SizeValueType numberOfPixels = moments.GetNumberOfPixels();
+  const double size = static_cast<double>( numberOfPixels );
+
+  // mean and covariance of the indexes, relative to the reference
+  const VectorType mean = moments.GetSum() / size;
+  MatrixType indexCovariance = moments.GetSumOfProducts();
+  indexCovariance /= size;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      indexCovariance(i,j) -= mean[i] * mean[j];
+      }
+    }
+
+  // The physical point is origin + A*index, so the centroid is mapped
+  // with A and the central moments are A*C*A^T.
+  const MatrixType & indexToPhysical = output->GetIndexToPhysicalPoint();
+
+  VectorType centroidIndex = mean;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    centroidIndex[i] += moments.GetReference()[i];
+    }
+  const CentroidType centroid = output->GetOrigin() + indexToPhysical * centroidIndex;
+
+  MatrixType centralMoments = indexToPhysical * indexCovariance * MatrixType( indexToPhysical.GetTranspose() );
+
+  // the second order central moment of a pixel, along the axes of the
+  // image as in ShapeLabelMapFilter
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    centralMoments(i,i) += output->GetSpacing()[i] * output->GetSpacing()[i] / 12.0;
+    }
+
+  // The eigenvectors are returned as the rows of a proper rotation,
+  // by increasing eigenvalue.
+  VectorType principalMoments;
+  MatrixType principalAxes;
+  SmallSymmetricEigenSystem<ImageDimension>::Compute( centralMoments, principalMoments, principalAxes );
+
+  RegionType boundingBox;
+  boundingBox.SetIndex( moments.GetMinimum() );
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    boundingBox.SetSize( i, moments.GetMaximum()[i] - moments.GetMinimum()[i] + 1 );
+    }
+
+  double physicalSize = size;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    physicalSize *= output->GetSpacing()[i];
+    }
+
+  labelObject->SetNumberOfPixels( numberOfPixels );
+  labelObject->SetPhysicalSize( physicalSize );
+  labelObject->SetBoundingBox( boundingBox );
+  labelObject->SetCentroid( centroid );
+  labelObject->SetPrincipalMoments( principalMoments );
+  labelObject->SetPrincipalAxes( principalAxes );
+}
+
+} // end namespace itk
+#endif
@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkScheduledLabelMapFilter_h
+#define itkScheduledLabelMapFilter_h
+
+#include "itkLabelObjectScheduler.h"
+
+namespace itk
+{
+
+/** \class ScheduledLabelMapFilter
+ * \brief Distributes the label objects to the threads with a
+ * LabelObjectScheduler.
+ *
+ * This class is inserted between a filter and its superclass,
+ * InPlaceLabelMapFilter or one of its subclasses such as
+ * ShapeLabelMapFilter, and replaces the label order iteration of
+ * LabelMapFilter: the threads take the label objects from a shared
+ * queue, by default in order of decreasing estimated cost.
+ *
+ * Subclasses only implement ThreadedProcessLabelObject, and call the
+ * Before/AfterThreadedGenerateData methods of this class when they
+ * override them. The processing of a large label object can be split
+ * into chunks shared with the idle threads with the
+ * LabelObjectScheduler::ProcessChunks method of
+ * GetLabelObjectScheduler.
+ *
+ * When TSuperclass is itself a ScheduledLabelMapFilter, as
+ * PrincipalMomentsLabelMapFilter, the scheduler of the most derived
+ * class is used by both.
+ *
+ * \ingroup ITKLabelMap
+ * \ingroup ITKOBBLabelMap
+ */
+template< class TSuperclass >
+class ScheduledLabelMapFilter:
+  public TSuperclass
+{
+public:
+  /** Standard class typedefs. */
+  typedef ScheduledLabelMapFilter    Self;
+  typedef TSuperclass                Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Some convenient typedefs. */
+  typedef typename Superclass::LabelObjectType       LabelObjectType;
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+
+  typedef LabelObjectScheduler< LabelObjectType >    LabelObjectSchedulerType;
+
+  /** Runtime information support. */
+  itkTypeMacro(ScheduledLabelMapFilter, TSuperclass);
+
+  /** Set/Get whether label objects are processed in order of
+   * decreasing estimated cost, the number of lines, instead of label
+   * order. Processing the largest objects first avoids a long tail
+   * with a single busy thread. Defaults to On.
+   */
+  itkSetMacro(CostOrderedScheduling, bool);
+  itkGetConstMacro(CostOrderedScheduling, bool);
+  itkBooleanMacro(CostOrderedScheduling);
+
+  /** Set/Get the number of lines at which the processing of a single
+   * label object is split into chunks shared with the idle threads,
+   * in the subclasses which split it. Zero disables the
+   * splitting. Defaults to 65536.
+   *
+   * When TSuperclass is itself a ScheduledLabelMapFilter, the value
+   * of the most derived class is used by both, as the accessors are
+   * virtual.
+   */
+  itkSetMacro(LargeLabelObjectNumberOfLines, SizeValueType);
+  itkGetConstMacro(LargeLabelObjectNumberOfLines, SizeValueType);
+
+protected:
+  ScheduledLabelMapFilter();
+  ~ScheduledLabelMapFilter() {}
+
+  virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  virtual void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId) ITK_OVERRIDE;
+
+  virtual void AfterThreadedGenerateData() ITK_OVERRIDE;
+
+  virtual void PrintSelf(std::ostream & os, Indent indent) const ITK_OVERRIDE;
+
+  /** Get the scheduler of the label objects, which is only
+   * initialized during the update. */
+  virtual LabelObjectSchedulerType * GetLabelObjectScheduler() const
+  {
+    return &m_Scheduler;
+  }
+
+private:
+  ScheduledLabelMapFilter(const Self &); //purposely not implemented
+  void operator=(const Self &);          //purposely not implemented
+
+  bool                             m_CostOrderedScheduling;
+  SizeValueType                    m_LargeLabelObjectNumberOfLines;
+  mutable LabelObjectSchedulerType m_Scheduler;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkScheduledLabelMapFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkScheduledLabelMapFilter_hxx
+#define itkScheduledLabelMapFilter_hxx
+
+#include "itkScheduledLabelMapFilter.h"
+
+namespace itk
+{
+
+template< class TSuperclass >
+ScheduledLabelMapFilter< TSuperclass >
+::ScheduledLabelMapFilter()
+  : m_CostOrderedScheduling( true ),
+    m_LargeLabelObjectNumberOfLines( 65536 )
+{
+}
+
+template< class TSuperclass >
+void
+ScheduledLabelMapFilter< TSuperclass >
+::BeforeThreadedGenerateData()
+{
+  Superclass::BeforeThreadedGenerateData();
+
+  // a subclass which is also a ScheduledLabelMapFilter runs the threads
+  if ( this->GetLabelObjectScheduler() == &m_Scheduler )
+    {
+    m_Scheduler.Initialize( this, this->GetLabelMap(), m_CostOrderedScheduling );
+    }
+}
+
+template< class TSuperclass >
+void
+ScheduledLabelMapFilter< TSuperclass >
+::ThreadedGenerateData(const OutputImageRegionType &, ThreadIdType)
+{
+  LabelObjectType *labelObject;
+  while( ( labelObject = m_Scheduler.GetNextLabelObject() ) != NULL )
+    {
+    try
+      {
+      this->ThreadedProcessLabelObject(labelObject);
+      }
+    catch ( ... )
+      {
+      m_Scheduler.CompletedLabelObject();
+      throw;
+      }
+    m_Scheduler.CompletedLabelObject();
+    }
+}
+
+template< class TSuperclass >
+void
+ScheduledLabelMapFilter< TSuperclass >
+::AfterThreadedGenerateData()
+{
+  m_Scheduler.Clear();
+  Superclass::AfterThreadedGenerateData();
+}
+
+template< class TSuperclass >
+void
+ScheduledLabelMapFilter< TSuperclass >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  // the properties of a nested ScheduledLabelMapFilter are not used
+  if ( this->GetLabelObjectScheduler() == &m_Scheduler )
+    {
+    os << indent << "CostOrderedScheduling: " << m_CostOrderedScheduling << std::endl;
+    os << indent << "LargeLabelObjectNumberOfLines: " << m_LargeLabelObjectNumberOfLines << std::endl;
+    }
+}
+
+} // end namespace itk
+
+#endif
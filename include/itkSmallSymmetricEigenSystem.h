@@ -0,0 +1,251 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkSmallSymmetricEigenSystem_h
+#define itkSmallSymmetricEigenSystem_h
+
+#include "itkMatrix.h"
+#include "itkVector.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/** \class SmallSymmetricEigenSystem
+ * \brief Eigen decomposition of a small, fixed size, real symmetric
+ * matrix, such as the 2x2 and 3x3 second order moments.
+ *
+ * The decomposition is computed with cyclic Jacobi rotations on the
+ * stack, without heap allocation. A 2x2 matrix is diagonalized by a
+ * single rotation, which is the closed form solution, and a 3x3
+ * matrix converges to full precision in a few sweeps. Jacobi
+ * rotations are robust for repeated eigenvalues and for degenerate,
+ * rank deficient or zero matrices, which are common for the moments
+ * of lines and single pixels: the eigenvectors stay orthonormal in
+ * all cases.
+ *
+ * The eigenvalues are returned in increasing order and the
+ * eigenvectors are the rows of the returned matrix, in the same
+ * order. The last eigenvector is negated if needed so the
+ * eigenvectors form a proper rotation. This is the convention of the
+ * principal moments and axes of ShapeLabelObject.
+ *
+ * \ingroup ITKOBBLabelMap
+ */
+template< unsigned int VDimension >
+class SmallSymmetricEigenSystem
+{
+public:
+  itkStaticConstMacro(Dimension, unsigned int, VDimension);
+
+  typedef Matrix< double, VDimension, VDimension > MatrixType;
+  typedef Vector< double, VDimension >             VectorType;
+
+  /** Compute the eigenvalues and eigenvectors of the symmetric
+   * matrix. Only the upper triangle of the matrix is read. */
+  static void Compute( const MatrixType &matrix,
+                       VectorType &eigenValues,
+                       MatrixType &eigenVectors )
+  {
+    double a[VDimension][VDimension];
+    double v[VDimension][VDimension];
+    for ( unsigned int i = 0; i < VDimension; ++i )
+      {
+      for ( unsigned int j = 0; j < VDimension; ++j )
+        {
+        a[i][j] = ( i <= j ) ? matrix(i,j) : matrix(j,i);
+        v[i][j] = ( i == j ) ? 1.0 : 0.0;
+        }
+      }
+
+    const double epsilon = NumericTraits<double>::epsilon();
+
+    for ( unsigned int sweep = 0; sweep < MaximumNumberOfSweeps; ++sweep )
+      {
+      double offDiagonal = 0.0;
+      double diagonal = 0.0;
+      for ( unsigned int p = 0; p < VDimension; ++p )
+        {
+        diagonal += a[p][p] * a[p][p];
+        for ( unsigned int q = p + 1; q < VDimension; ++q )
+          {
+          offDiagonal += a[p][q] * a[p][q];
+          }
+        }
+      if ( offDiagonal == 0.0 || offDiagonal <= epsilon * epsilon * diagonal )
+        {
+        break;
+        }
+
+      for ( unsigned int p = 0; p < VDimension; ++p )
+        {
+        for ( unsigned int q = p + 1; q < VDimension; ++q )
+          {
+          Rotate( a, v, p, q );
+          }
+        }
+      }
+
+    // sort by increasing eigenvalue, the eigenvectors are the columns
+    // of v
+    unsigned int order[VDimension];
+    for ( unsigned int i = 0; i < VDimension; ++i )
+      {
+      order[i] = i;
+      }
+    for ( unsigned int i = 1; i < VDimension; ++i )
+      {
+      for ( unsigned int j = i; j > 0 && a[order[j]][order[j]] < a[order[j-1]][order[j-1]]; --j )
+        {
+        std::swap( order[j], order[j-1] );
+        }
+      }
+
+    for ( unsigned int i = 0; i < VDimension; ++i )
+      {
+      eigenValues[i] = a[order[i]][order[i]];
+      for ( unsigned int j = 0; j < VDimension; ++j )
+        {
+        eigenVectors(i,j) = v[j][order[i]];
+        }
+      }
+
+    if ( Determinant( eigenVectors ) < 0.0 )
+      {
+      for ( unsigned int j = 0; j < VDimension; ++j )
+        {
+        eigenVectors(VDimension - 1, j) = -eigenVectors(VDimension - 1, j);
+        }
+      }
+  }
+
+private:
+  itkStaticConstMacro(MaximumNumberOfSweeps, unsigned int, 50);
+
+  /** Zero a[p][q] with a Jacobi rotation, accumulated into v. */
+  static void Rotate( double a[VDimension][VDimension],
+                      double v[VDimension][VDimension],
+                      unsigned int p,
+                      unsigned int q )
+  {
+    const double apq = a[p][q];
+    if ( apq == 0.0 )
+      {
+      return;
+      }
+
+    // The tangent t of the rotation angle is the smaller root of
+    // t^2 + 2*theta*t - 1 = 0, which keeps the rotation below 45
+    // degrees. For a huge theta the root is 1/(2*theta).
+    const double theta = ( a[q][q] - a[p][p] ) / ( 2.0 * apq );
+    double t;
+    if ( std::abs( theta ) > 1e150 )
+      {
+      t = 0.5 / theta;
+      }
+    else
+      {
+      t = 1.0 / ( std::abs( theta ) + std::sqrt( theta * theta + 1.0 ) );
+      if ( theta < 0.0 )
+        {
+        t = -t;
+        }
+      }
+    const double c = 1.0 / std::sqrt( t * t + 1.0 );
+    const double s = t * c;
+
+    for ( unsigned int k = 0; k < VDimension; ++k )
+      {
+      const double akp = a[k][p];
+      const double akq = a[k][q];
+      a[k][p] = c * akp - s * akq;
+      a[k][q] = s * akp + c * akq;
+      }
+    for ( unsigned int k = 0; k < VDimension; ++k )
+      {
+      const double apk = a[p][k];
+      const double aqk = a[q][k];
+      a[p][k] = c * apk - s * aqk;
+      a[q][k] = s * apk + c * aqk;
+      }
+    // exact by construction
+    a[p][q] = 0.0;
+    a[q][p] = 0.0;
+
+    for ( unsigned int k = 0; k < VDimension; ++k )
+      {
+      const double vkp = v[k][p];
+      const double vkq = v[k][q];
+      v[k][p] = c * vkp - s * vkq;
+      v[k][q] = s * vkp + c * vkq;
+      }
+  }
+
+  /** Determinant by Gaussian elimination with partial pivoting. */
+  static double Determinant( const MatrixType &m )
+  {
+    double lu[VDimension][VDimension];
+    for ( unsigned int i = 0; i < VDimension; ++i )
+      {
+      for ( unsigned int j = 0; j < VDimension; ++j )
+        {
+        lu[i][j] = m(i,j);
+        }
+      }
+
+    double det = 1.0;
+    for ( unsigned int k = 0; k < VDimension; ++k )
+      {
+      unsigned int pivot = k;
+      for ( unsigned int i = k + 1; i < VDimension; ++i )
+        {
+        if ( std::abs( lu[i][k] ) > std::abs( lu[pivot][k] ) )
+          {
+          pivot = i;
+          }
+        }
+      if ( lu[pivot][k] == 0.0 )
+        {
+        return 0.0;
+        }
+      if ( pivot != k )
+        {
+        for ( unsigned int j = 0; j < VDimension; ++j )
+          {
+          std::swap( lu[k][j], lu[pivot][j] );
+          }
+        det = -det;
+        }
+      det *= lu[k][k];
+      for ( unsigned int i = k + 1; i < VDimension; ++i )
+        {
+        const double f = lu[i][k] / lu[k][k];
+        for ( unsigned int j = k + 1; j < VDimension; ++j )
+          {
+          lu[i][j] -= f * lu[k][j];
+          }
+        }
+      }
+    return det;
+  }
+};
+
+} // end namespace itk
+
+#endif
@@ -11,7 +11,7 @@ if (NOT "${ITK_VERSION_MAJOR}.${ITK_VERSION_MINOR}.${ITK_VERSION_MINOR_PATCH}" V
 endif()
 
 # itk_module() defines the module dependencies in ITKOBBLabelMap
-# ITKOBBLabelMap depends on ITKCommon
+# ITKOBBLabelMap depends on ITKCommon, ITKIOImageBase and ITKLabelMap
 # The testing module in ITKOBBLabelMap depends on ITKTestKernel
 # and ITKMetaIO(besides ITKOBBLabelMap and ITKCore)
  
@@ -19,6 +19,7 @@ endif()
 itk_module(ITKOBBLabelMap
   DEPENDS
     ITKCommon
+    ITKIOImageBase
     ITKLabelMap
   TEST_DEPENDS
     ITKTestKernel
@@ -0,0 +1,257 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkAttributeImageLabelObject.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef itk::Image<float, ImageDimension>                                        ImageType;
+typedef itk::AttributeImageLabelObject< unsigned int, ImageDimension, ImageType > LabelObjectType;
+
+// A crop of 20x15x10 pixels, masked by an ellipsoid, or filled with
+// noise.
+ImageType::Pointer CreateImage( bool noise )
+{
+  ImageType::SizeType size;
+  size[0] = 20;
+  size[1] = 15;
+  size[2] = 10;
+  ImageType::RegionType region;
+  region.SetSize( size );
+
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.3;
+  ImageType::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = -2.75;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->Allocate();
+
+  unsigned int seed = 1;
+  itk::ImageRegionIteratorWithIndex<ImageType> it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const ImageType::IndexType & idx = it.GetIndex();
+    if ( noise )
+      {
+      seed = seed * 1103515245u + 12345u;
+      it.Set( static_cast<float>( seed ) / 65536.0f );
+      }
+    else
+      {
+      const double x = idx[0] - 10.0;
+      const double y = idx[1] - 7.0;
+      const double z = idx[2] - 5.0;
+      it.Set( x*x/64.0 + y*y/36.0 + z*z/16.0 <= 1.0 ? 100.0f * std::sin( 0.3 * idx[0] ) + idx[1] : 0.0f );
+      }
+    }
+  return image;
+}
+
+bool CompareImages( const ImageType *expected, const ImageType *result )
+{
+  if ( result == ITK_NULLPTR
+       || expected->GetBufferedRegion() != result->GetBufferedRegion()
+       || expected->GetLargestPossibleRegion() != result->GetLargestPossibleRegion()
+       || expected->GetOrigin() != result->GetOrigin()
+       || expected->GetSpacing() != result->GetSpacing()
+       || expected->GetDirection() != result->GetDirection() )
+    {
+    std::cerr << "The attribute images have different geometries" << std::endl;
+    return false;
+    }
+
+  itk::ImageRegionConstIterator<ImageType> eit( expected, expected->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<ImageType> rit( result, result->GetBufferedRegion() );
+  for ( ; !eit.IsAtEnd(); ++eit, ++rit )
+    {
+    if ( eit.Get() != rit.Get() )
+      {
+      std::cerr << "Pixel is " << rit.Get() << " expected " << eit.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkAttributeImageLabelObjectTest( int , char ** )
+{
+  ImageType::Pointer masked = CreateImage( false );
+  ImageType::Pointer noise = CreateImage( true );
+  const itk::SizeValueType rawSize = masked->GetBufferedRegion().GetNumberOfPixels() * sizeof( float );
+
+  LabelObjectType::Pointer labelObject = LabelObjectType::New();
+  labelObject->SetAttributeImage( masked );
+  labelObject->SetNthAttributeImage( 2, noise );
+  TEST_SET_GET_VALUE( 3u, labelObject->GetNumberOfAttributeImages() );
+  TEST_SET_GET_VALUE( 0u, labelObject->GetCompressedAttributeImagesSize() );
+
+  // the originals are kept by the test, the label object holds the
+  // compressed copies
+  labelObject->CompressAttributeImages();
+  const itk::SizeValueType compressedSize = labelObject->GetCompressedAttributeImagesSize();
+  std::cout << "Compressed " << 2 * rawSize << " bytes to " << compressedSize << std::endl;
+  TEST_EXPECT_TRUE( compressedSize < 2 * rawSize );
+  TEST_EXPECT_TRUE( labelObject->GetNthAttributeImage( 1 ) == ITK_NULLPTR );
+
+  const ImageType *image = labelObject->GetAttributeImage();
+  TEST_EXPECT_TRUE( image != masked.GetPointer() );
+  if ( !CompareImages( masked, image ) || !CompareImages( noise, labelObject->GetNthAttributeImage( 2 ) ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // resident until compressed again
+  TEST_EXPECT_TRUE( labelObject->GetAttributeImage() == image );
+  labelObject->CompressAttributeImages();
+  TEST_SET_GET_VALUE( compressedSize, labelObject->GetCompressedAttributeImagesSize() );
+
+  // the changes are kept by compressing again
+  ImageType::IndexType idx;
+  idx.Fill( 0 );
+  labelObject->GetAttributeImage()->SetPixel( idx, 42.0f );
+  labelObject->CompressAttributeImages();
+  TEST_SET_GET_VALUE( 42.0f, labelObject->GetAttributeImage()->GetPixel( idx ) );
+  labelObject->GetAttributeImage()->SetPixel( idx, 0.0f );
+
+  // a new image replaces the compressed one
+  ImageType::Pointer other = CreateImage( false );
+  labelObject->SetAttributeImage( other );
+  TEST_EXPECT_TRUE( labelObject->GetAttributeImage() == other.GetPointer() );
+  TEST_EXPECT_TRUE( labelObject->GetCompressedAttributeImagesSize() < compressedSize );
+
+  // only the region of a view is compressed
+  ImageType::RegionType viewRegion;
+  viewRegion.SetIndex( 0, 2 );
+  viewRegion.SetIndex( 1, 3 );
+  viewRegion.SetIndex( 2, 1 );
+  viewRegion.SetSize( 0, 5 );
+  viewRegion.SetSize( 1, 4 );
+  viewRegion.SetSize( 2, 3 );
+
+  ImageType::Pointer view = ImageType::New();
+  view->CopyInformation( noise );
+  view->SetLargestPossibleRegion( viewRegion );
+  view->SetRequestedRegion( viewRegion );
+  view->SetBufferedRegion( noise->GetBufferedRegion() );
+  view->SetPixelContainer( noise->GetPixelContainer() );
+
+  LabelObjectType::Pointer viewObject = LabelObjectType::New();
+  viewObject->SetAttributeImage( view );
+  viewObject->CompressAttributeImages();
+  TEST_EXPECT_TRUE( viewObject->GetCompressedAttributeImagesSize() < 2 * viewRegion.GetNumberOfPixels() * sizeof( float ) );
+
+  ImageType::ConstPointer viewCopy = viewObject->GetAttributeImage();
+  TEST_EXPECT_TRUE( viewCopy->GetLargestPossibleRegion() == viewRegion );
+  TEST_EXPECT_TRUE( viewCopy->GetBufferedRegion() == viewRegion );
+  itk::ImageRegionConstIterator<ImageType> nit( noise, viewRegion );
+  itk::ImageRegionConstIterator<ImageType> cit( viewCopy, viewRegion );
+  for ( ; !nit.IsAtEnd(); ++nit, ++cit )
+    {
+    if ( nit.Get() != cit.Get() )
+      {
+      std::cerr << "View pixel is " << cit.Get() << " expected " << nit.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // a view of an empty region is compressed to an empty image
+  ImageType::RegionType emptyRegion = viewRegion;
+  emptyRegion.SetSize( 1, 0 );
+  view->SetLargestPossibleRegion( emptyRegion );
+  view->SetRequestedRegion( emptyRegion );
+  viewObject->SetAttributeImage( view );
+  viewObject->CompressAttributeImages();
+  TEST_SET_GET_VALUE( 0u, viewObject->GetCompressedAttributeImagesSize() );
+  TEST_SET_GET_VALUE( 0u, viewObject->GetAttributeImage()->GetBufferedRegion().GetNumberOfPixels() );
+
+  // three label objects sharing a cache of two images
+  itk::AttributeImageCache::Pointer cache = itk::AttributeImageCache::New();
+  TEST_SET_GET_VALUE( 16u, cache->GetMaximumNumberOfImages() );
+  cache->SetMaximumNumberOfImages( 2 );
+
+  std::vector<LabelObjectType::Pointer> labelObjects;
+  for ( unsigned int i = 0; i < 3; ++i )
+    {
+    labelObjects.push_back( LabelObjectType::New() );
+    labelObjects[i]->SetAttributeImageCache( cache );
+    labelObjects[i]->SetAttributeImage( i == 1 ? noise : masked );
+    labelObjects[i]->CompressAttributeImages();
+    }
+  TEST_SET_GET_VALUE( 0u, cache->GetNumberOfImages() );
+
+  ImageType::Pointer first = labelObjects[0]->GetAttributeImage();
+  for ( unsigned int i = 0; i < 3; ++i )
+    {
+    if ( !CompareImages( i == 1 ? noise : masked, labelObjects[i]->GetAttributeImage() ) )
+      {
+      std::cerr << "Label object " << i << " failed" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  TEST_SET_GET_VALUE( 2u, cache->GetNumberOfImages() );
+
+  // the least recently used image was released, and is decompressed
+  // again
+  TEST_EXPECT_TRUE( labelObjects[0]->GetAttributeImage() != first.GetPointer() );
+  TEST_EXPECT_TRUE( CompareImages( first, labelObjects[0]->GetAttributeImage() ) );
+  TEST_SET_GET_VALUE( 2u, cache->GetNumberOfImages() );
+
+  // an image held by a SmartPointer stays valid after it is released
+  // by the cache
+  ImageType::ConstPointer held = labelObjects[1]->GetAttributeImage();
+  labelObjects[2]->GetAttributeImage();
+  labelObjects[0]->GetAttributeImage();
+  if ( !CompareImages( noise, held ) )
+    {
+    std::cerr << "The image released by the cache was freed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  TEST_EXPECT_TRUE( labelObjects[1]->GetAttributeImage() != held.GetPointer() );
+
+  // the resident images of a copy are tracked by the cache
+  cache->SetMaximumNumberOfImages( 3 );
+  LabelObjectType::Pointer copy = LabelObjectType::New();
+  copy->CopyAttributesFrom( labelObjects[1] );
+  TEST_SET_GET_VALUE( 3u, cache->GetNumberOfImages() );
+  copy = ITK_NULLPTR;
+  TEST_SET_GET_VALUE( 2u, cache->GetNumberOfImages() );
+  cache->SetMaximumNumberOfImages( 2 );
+
+  // the images of a deleted label object leave the cache
+  labelObjects[0] = ITK_NULLPTR;
+  TEST_SET_GET_VALUE( 1u, cache->GetNumberOfImages() );
+
+  return EXIT_SUCCESS;
+}
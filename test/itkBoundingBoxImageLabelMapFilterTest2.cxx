@@ -0,0 +1,217 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+typedef itk::Image<unsigned char, ImageDimension>     CharImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > OBBLabelObjectType;
+
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType >     LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                      LabelMapType;
+typedef itk::BoundingBoxImageLabelMapFilter<LabelMapType>                                                   FilterType;
+
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, CharImageType, OBBLabelObjectType > CharLabelObjectType;
+typedef itk::LabelMap<CharLabelObjectType>                                                                  CharLabelMapType;
+typedef itk::BoundingBoxImageLabelMapFilter<CharLabelMapType, ImageType>                                    CharFilterType;
+
+const unsigned char OutputMinimum = 10;
+const unsigned char OutputMaximum = 240;
+const double        WindowMinimum = -20.0;
+const double        WindowMaximum = 80.0;
+
+template< class TImage >
+void SetGeometry( TImage *image )
+{
+  typename TImage::SizeType imageSize;
+  imageSize.Fill( 30 );
+  typename TImage::RegionType region;
+  region.SetSize( imageSize );
+  image->SetRegions( region );
+
+  typename TImage::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.3;
+  image->SetSpacing( spacing );
+
+  typename TImage::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = 2.75;
+  image->SetOrigin( origin );
+}
+
+template< class TLabelMap >
+typename TLabelMap::Pointer CreateLabelMap()
+{
+  typedef typename TLabelMap::LabelObjectType LabelObjectType;
+
+  typename TLabelMap::Pointer labelMap = TLabelMap::New();
+  SetGeometry( labelMap.GetPointer() );
+  labelMap->Allocate();
+
+  // an ellipsoid and a box touching the border of the image
+  typename LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  typename LabelObjectType::Pointer box = LabelObjectType::New();
+  box->SetLabel( 2 );
+  const typename TLabelMap::RegionType region = labelMap->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const typename TLabelMap::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 12.0 + 0.5 * ( idx[1] - 14.0 );
+    const double y = idx[1] - 14.0;
+    const double z = idx[2] - 15.0;
+    if ( x*x/64.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    else if ( idx[0] >= 24 && idx[1] < 5 && idx[2] >= 20 && idx[2] < 23 )
+      {
+      box->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  box->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+  labelMap->AddLabelObject( box );
+  return labelMap;
+}
+
+// Check that the attribute image is the crop of the feature image
+// padded by one pixel, windowed onto the output range.
+template< class TLabelObject >
+bool CheckCrop( const TLabelObject *labelObject, const ImageType *feature, double scale, double shift,
+                double minimum, double maximum )
+{
+  typedef typename TLabelObject::AttributeImageType AttributeImageType;
+  const AttributeImageType *image = labelObject->GetAttributeImage();
+
+  ImageType::RegionType bb = labelObject->GetBoundingBox();
+  bb.PadByRadius( 1 );
+  bb.Crop( feature->GetLargestPossibleRegion() );
+
+  ImageType::PointType origin;
+  feature->TransformIndexToPhysicalPoint( bb.GetIndex(), origin );
+  ImageType::IndexType zeroIndex;
+  zeroIndex.Fill( 0 );
+  if ( image->GetBufferedRegion().GetSize() != bb.GetSize()
+       || image->GetBufferedRegion().GetIndex() != zeroIndex
+       || image->GetOrigin() != origin
+       || image->GetSpacing() != feature->GetSpacing() )
+    {
+    std::cerr << "The attribute image of label " << labelObject->GetLabel()
+              << " is not the padded bounding box" << std::endl;
+    return false;
+    }
+
+  itk::ImageRegionConstIteratorWithIndex<AttributeImageType> it( image, image->GetBufferedRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::IndexType idx = it.GetIndex();
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      idx[i] += bb.GetIndex( i );
+      }
+    const double value = std::max( minimum, std::min( maximum, ( feature->GetPixel( idx ) + shift ) * scale ) );
+    if ( std::abs( value - static_cast<double>( it.Get() ) ) >= 1.0 )
+      {
+      std::cerr << "Pixel " << it.GetIndex() << " of label " << labelObject->GetLabel() << " is "
+                << static_cast<double>( it.Get() ) << " expected " << value << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkBoundingBoxImageLabelMapFilterTest2( int , char ** )
+{
+  LabelMapType::Pointer labelMap = CreateLabelMap<LabelMapType>();
+  CharLabelMapType::Pointer charLabelMap = CreateLabelMap<CharLabelMapType>();
+
+  ImageType::Pointer feature = ImageType::New();
+  SetGeometry( feature.GetPointer() );
+  feature->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, feature->GetBufferedRegion() );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    ImageType::PointType p;
+    feature->TransformIndexToPhysicalPoint( fit.GetIndex(), p );
+    fit.Set( 100.0 * std::sin( 0.4 * p[0] ) * std::cos( 0.2 * p[1] ) + 3.0 * p[2] );
+    }
+
+  // the float crop without mapping
+  FilterType::Pointer reference = FilterType::New();
+  reference->SetInput( labelMap );
+  reference->InPlaceOff();
+  reference->SetFeatureImage( feature );
+  reference->SetPaddingOffset( 1 );
+  reference->Update();
+
+  CharFilterType::Pointer filter = CharFilterType::New();
+  filter->SetInput( charLabelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+  filter->SetPaddingOffset( 1 );
+
+  TEST_SET_GET_VALUE( 0.0, filter->GetShift() );
+  TEST_SET_GET_VALUE( 1.0, filter->GetScale() );
+  TEST_SET_GET_VALUE( 0, filter->GetOutputMinimum() );
+  TEST_SET_GET_VALUE( 255, filter->GetOutputMaximum() );
+
+  filter->SetOutputMinimum( OutputMinimum );
+  filter->SetOutputMaximum( OutputMaximum );
+  filter->SetIntensityWindow( WindowMinimum, WindowMaximum );
+  TEST_SET_GET_VALUE( 2.3, filter->GetScale() );
+
+  TRY_EXPECT_EXCEPTION( filter->SetIntensityWindow( 5.0, 5.0 ) );
+
+  filter->Update();
+
+  for ( LabelPixelType label = 1; label <= 2; ++label )
+    {
+    if ( !CheckCrop( reference->GetOutput()->GetLabelObject( label ), feature, 1.0, 0.0,
+                     -1e30, 1e30 )
+         || !CheckCrop( filter->GetOutput()->GetLabelObject( label ), feature, 2.3,
+                        OutputMinimum / 2.3 - WindowMinimum, OutputMinimum, OutputMaximum ) )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
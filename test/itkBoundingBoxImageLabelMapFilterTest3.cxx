@@ -0,0 +1,188 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+typedef itk::Image<unsigned char, ImageDimension>     CharImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > OBBLabelObjectType;
+
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType >     LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                      LabelMapType;
+typedef itk::BoundingBoxImageLabelMapFilter<LabelMapType>                                                   FilterType;
+
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, CharImageType, OBBLabelObjectType > CharLabelObjectType;
+typedef itk::LabelMap<CharLabelObjectType>                                                                  CharLabelMapType;
+typedef itk::BoundingBoxImageLabelMapFilter<CharLabelMapType, ImageType>                                    CharFilterType;
+
+template< class TImage >
+void SetGeometry( TImage *image )
+{
+  typename TImage::SizeType imageSize;
+  imageSize.Fill( 30 );
+  typename TImage::RegionType region;
+  region.SetSize( imageSize );
+  image->SetRegions( region );
+
+  typename TImage::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.3;
+  image->SetSpacing( spacing );
+
+  typename TImage::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = 2.75;
+  image->SetOrigin( origin );
+}
+
+template< class TLabelMap >
+typename TLabelMap::Pointer CreateLabelMap()
+{
+  typedef typename TLabelMap::LabelObjectType LabelObjectType;
+
+  typename TLabelMap::Pointer labelMap = TLabelMap::New();
+  SetGeometry( labelMap.GetPointer() );
+  labelMap->Allocate();
+
+  // two overlapping ellipsoids, the second one touching the border of
+  // the image
+  typename LabelObjectType::Pointer first = LabelObjectType::New();
+  first->SetLabel( 1 );
+  typename LabelObjectType::Pointer second = LabelObjectType::New();
+  second->SetLabel( 2 );
+  const typename TLabelMap::RegionType region = labelMap->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const typename TLabelMap::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 12.0 + 0.5 * ( idx[1] - 14.0 );
+    const double y = idx[1] - 14.0;
+    const double z = idx[2] - 15.0;
+    if ( x*x/64.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      first->AddIndex( idx );
+      }
+    else if ( ( idx[0] - 24.0 ) * ( idx[0] - 24.0 ) + y*y/4.0 + z*z <= 36.0 )
+      {
+      second->AddIndex( idx );
+      }
+    }
+  first->Optimize();
+  second->Optimize();
+  labelMap->AddLabelObject( first );
+  labelMap->AddLabelObject( second );
+  return labelMap;
+}
+
+}
+
+int itkBoundingBoxImageLabelMapFilterTest3( int , char ** )
+{
+  LabelMapType::Pointer labelMap = CreateLabelMap<LabelMapType>();
+
+  ImageType::Pointer feature = ImageType::New();
+  SetGeometry( feature.GetPointer() );
+  feature->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, feature->GetBufferedRegion() );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    ImageType::PointType p;
+    feature->TransformIndexToPhysicalPoint( fit.GetIndex(), p );
+    fit.Set( 100.0 * std::sin( 0.4 * p[0] ) * std::cos( 0.2 * p[1] ) + 3.0 * p[2] );
+    }
+
+  // the copies of the bounding boxes
+  FilterType::Pointer reference = FilterType::New();
+  reference->SetInput( labelMap );
+  reference->InPlaceOff();
+  reference->SetFeatureImage( feature );
+  reference->SetPaddingOffset( 2 );
+  reference->Update();
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+  filter->SetPaddingOffset( 2 );
+
+  TEST_SET_GET_VALUE( false, filter->GetUseFeatureImageView() );
+  filter->UseFeatureImageViewOn();
+  TEST_SET_GET_VALUE( true, filter->GetUseFeatureImageView() );
+
+  filter->Update();
+
+  for ( LabelPixelType label = 1; label <= 2; ++label )
+    {
+    const ImageType *copy = reference->GetOutput()->GetLabelObject( label )->GetAttributeImage();
+    const ImageType *view = filter->GetOutput()->GetLabelObject( label )->GetAttributeImage();
+
+    // the view shares the buffer of the feature image
+    TEST_EXPECT_TRUE( view->GetPixelContainer() == feature->GetPixelContainer() );
+    TEST_EXPECT_TRUE( view->GetBufferedRegion() == feature->GetBufferedRegion() );
+    TEST_EXPECT_TRUE( view->GetRequestedRegion() == view->GetLargestPossibleRegion() );
+    TEST_SET_GET_VALUE( copy->GetLargestPossibleRegion().GetSize(), view->GetLargestPossibleRegion().GetSize() );
+    TEST_EXPECT_TRUE( view->GetSpacing() == copy->GetSpacing() );
+    TEST_EXPECT_TRUE( view->GetDirection() == copy->GetDirection() );
+
+    // same pixels at the same physical points as the copy
+    itk::ImageRegionConstIteratorWithIndex<ImageType> cit( copy, copy->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIteratorWithIndex<ImageType> vit( view, view->GetLargestPossibleRegion() );
+    for ( ; !cit.IsAtEnd(); ++cit, ++vit )
+      {
+      ImageType::PointType copyPoint;
+      ImageType::PointType viewPoint;
+      copy->TransformIndexToPhysicalPoint( cit.GetIndex(), copyPoint );
+      view->TransformIndexToPhysicalPoint( vit.GetIndex(), viewPoint );
+      if ( copyPoint.EuclideanDistanceTo( viewPoint ) > 1e-9 || cit.Get() != vit.Get() )
+        {
+        std::cerr << "View pixel " << vit.GetIndex() << " of label " << label << " is " << vit.Get()
+                  << " expected " << cit.Get() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // not with an intensity mapping
+  filter->SetScale( 2.0 );
+  TRY_EXPECT_EXCEPTION( filter->Update() );
+
+  // not with another attribute image type
+  CharFilterType::Pointer charFilter = CharFilterType::New();
+  charFilter->SetInput( CreateLabelMap<CharLabelMapType>() );
+  charFilter->SetFeatureImage( feature );
+  charFilter->UseFeatureImageViewOn();
+  TRY_EXPECT_EXCEPTION( charFilter->Update() );
+
+  return EXIT_SUCCESS;
+}
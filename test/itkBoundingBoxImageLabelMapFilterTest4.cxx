@@ -0,0 +1,217 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <vector>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef itk::BoundingBoxImageLabelMapFilter<LabelMapType>                                               FilterType;
+
+bool CompareImages( const ImageType *expected, const ImageType *result )
+{
+  if ( expected->GetBufferedRegion() != result->GetBufferedRegion()
+       || expected->GetOrigin() != result->GetOrigin() )
+    {
+    std::cerr << "The attribute images have different geometries" << std::endl;
+    return false;
+    }
+
+  itk::ImageRegionConstIterator<ImageType> eit( expected, expected->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<ImageType> rit( result, result->GetBufferedRegion() );
+  for ( ; !eit.IsAtEnd(); ++eit, ++rit )
+    {
+    if ( eit.Get() != rit.Get() )
+      {
+      std::cerr << "Pixel is " << rit.Get() << " expected " << eit.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkBoundingBoxImageLabelMapFilterTest4( int , char ** )
+{
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  LabelMapType::SizeType size;
+  size.Fill( 30 );
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+
+  // an ellipsoid, a slanted line touching the border of the image and
+  // a single pixel, with labels out of order
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 5 );
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 12.0 + 0.5 * ( idx[1] - 14.0 );
+    const double y = idx[1] - 14.0;
+    const double z = idx[2] - 15.0;
+    if ( x*x/64.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+
+  LabelObjectType::Pointer line = LabelObjectType::New();
+  line->SetLabel( 2 );
+  for ( unsigned int i = 0; i < 6; ++i )
+    {
+    LabelMapType::IndexType idx;
+    idx[0] = 22 + i;
+    idx[1] = 1 + i;
+    idx[2] = 29 - i;
+    line->AddLine( idx, 8 - i );
+    }
+  labelMap->AddLabelObject( line );
+
+  LabelObjectType::Pointer pixel = LabelObjectType::New();
+  pixel->SetLabel( 9 );
+  LabelMapType::IndexType idx;
+  idx.Fill( 3 );
+  pixel->AddIndex( idx );
+  labelMap->AddLabelObject( pixel );
+
+  ImageType::Pointer feature = ImageType::New();
+  feature->SetRegions( region );
+  feature->Allocate();
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, region );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    const ImageType::IndexType & index = fit.GetIndex();
+    fit.Set( index[0] + 100.0 * index[1] + 10000.0 * index[2] );
+    }
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+
+  TEST_SET_GET_VALUE( false, filter->GetArenaAllocation() );
+  filter->ArenaAllocationOn();
+  TEST_SET_GET_VALUE( true, filter->GetArenaAllocation() );
+
+  // padded, then shrunk
+  for ( int padding = 2; padding >= -1; padding -= 3 )
+    {
+    FilterType::Pointer reference = FilterType::New();
+    reference->SetInput( labelMap );
+    reference->InPlaceOff();
+    reference->SetFeatureImage( feature );
+    reference->SetPaddingOffset( padding );
+    reference->Update();
+    TEST_EXPECT_TRUE( reference->GetAttributeImageArena() == ITK_NULLPTR );
+
+    filter->SetPaddingOffset( padding );
+    filter->Update();
+
+    // the slices of the arena follow the order of the labels, and
+    // cover the whole arena
+    const FilterType::AttributeImagePixelContainerType *arena = filter->GetAttributeImageArena();
+    TEST_EXPECT_TRUE( arena != ITK_NULLPTR );
+
+    const float *next = arena->GetBufferPointer();
+    for ( LabelMapType::ConstIterator it( filter->GetOutput() ); !it.IsAtEnd(); ++it )
+      {
+      const ImageType *image = it.GetLabelObject()->GetAttributeImage();
+      if ( image->GetBufferPointer() != next )
+        {
+        std::cerr << "The attribute image of label " << it.GetLabel() << " is not the next slice of the arena"
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      next += image->GetBufferedRegion().GetNumberOfPixels();
+
+      if ( !CompareImages( reference->GetOutput()->GetLabelObject( it.GetLabel() )->GetAttributeImage(), image ) )
+        {
+        std::cerr << "Label " << it.GetLabel() << " failed with padding " << padding << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    TEST_SET_GET_VALUE( arena->Size(), static_cast<itk::SizeValueType>( next - arena->GetBufferPointer() ) );
+    }
+
+  // the attribute images outlive the filter and its next updates
+  {
+  FilterType::Pointer reference = FilterType::New();
+  reference->SetInput( labelMap );
+  reference->InPlaceOff();
+  reference->SetFeatureImage( feature );
+  reference->Update();
+
+  FilterType::Pointer arenaFilter = FilterType::New();
+  arenaFilter->SetInput( labelMap );
+  arenaFilter->InPlaceOff();
+  arenaFilter->SetFeatureImage( feature );
+  arenaFilter->ArenaAllocationOn();
+  arenaFilter->Update();
+  LabelMapType::Pointer output = arenaFilter->GetOutput();
+  output->DisconnectPipeline();
+
+  typedef itk::ArenaSliceImageContainer< FilterType::AttributeImagePixelContainerType > SliceType;
+  const SliceType *slice = dynamic_cast<const SliceType *>( output->GetLabelObject( 5 )->GetAttributeImage()->GetPixelContainer() );
+  TEST_EXPECT_TRUE( slice != ITK_NULLPTR );
+  TEST_EXPECT_TRUE( slice->GetArena() == arenaFilter->GetAttributeImageArena() );
+
+  arenaFilter->Update();
+  arenaFilter = ITK_NULLPTR;
+
+  // reuse the memory a released arena would have left
+  std::vector<float> sentinel( 2 * slice->GetArena()->Size(), -1.0f );
+
+  for ( LabelMapType::ConstIterator it( output ); !it.IsAtEnd(); ++it )
+    {
+    if ( !CompareImages( reference->GetOutput()->GetLabelObject( it.GetLabel() )->GetAttributeImage(),
+                         it.GetLabelObject()->GetAttributeImage() ) )
+      {
+      std::cerr << "Label " << it.GetLabel() << " failed after the filter was destroyed" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // no arena for the views
+  filter->UseFeatureImageViewOn();
+  filter->Update();
+  TEST_EXPECT_TRUE( filter->GetAttributeImageArena() == ITK_NULLPTR );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageFileWriter.h"
+#include "itkMetaImageIO.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef itk::BoundingBoxImageLabelMapFilter<LabelMapType>                                               FilterType;
+
+const LabelPixelType NumberOfLabels = 9;
+
+bool CompareImages( const ImageType *expected, const ImageType *result )
+{
+  if ( expected->GetBufferedRegion() != result->GetBufferedRegion()
+       || expected->GetOrigin() != result->GetOrigin()
+       || expected->GetSpacing() != result->GetSpacing()
+       || expected->GetDirection() != result->GetDirection() )
+    {
+    std::cerr << "The attribute images have different geometries" << std::endl;
+    return false;
+    }
+
+  itk::ImageRegionConstIterator<ImageType> eit( expected, expected->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<ImageType> rit( result, result->GetBufferedRegion() );
+  for ( ; !eit.IsAtEnd(); ++eit, ++rit )
+    {
+    if ( eit.Get() != rit.Get() )
+      {
+      std::cerr << "Pixel is " << rit.Get() << " expected " << eit.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+bool CheckFileFilter( FilterType *filter, const FilterType *reference )
+{
+  for ( LabelPixelType label = 1; label <= NumberOfLabels; ++label )
+    {
+    if ( !CompareImages( reference->GetOutput()->GetLabelObject( label )->GetAttributeImage(),
+                         filter->GetOutput()->GetLabelObject( label )->GetAttributeImage() ) )
+      {
+      std::cerr << "Label " << label << " failed" << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkBoundingBoxImageLabelMapFilterTest5( int argc, char *argv[] )
+{
+  if ( argc < 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " featureImageFile" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ImageType::SizeType size;
+  size[0] = 30;
+  size[1] = 40;
+  size[2] = 50;
+  ImageType::RegionType region;
+  region.SetSize( size );
+
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.3;
+  ImageType::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = -2.75;
+  ImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction(0,0) = std::cos( 0.3 );
+  direction(0,1) = -std::sin( 0.3 );
+  direction(1,0) = std::sin( 0.3 );
+  direction(1,1) = std::cos( 0.3 );
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+  labelMap->SetSpacing( spacing );
+  labelMap->SetOrigin( origin );
+  labelMap->SetDirection( direction );
+  labelMap->Allocate();
+
+  // a cluster of boxes close to each other at the start of the image,
+  // another one at the end, and boxes touching the border of the image
+  const long boxes[NumberOfLabels][6] = {
+    {  2,  3,  1, 4, 3, 3 },
+    {  5,  4,  3, 3, 4, 4 },
+    {  3,  6,  6, 5, 2, 3 },
+    {  6,  2,  8, 2, 5, 2 },
+    { 20, 30, 38, 4, 4, 4 },
+    { 22, 33, 41, 5, 3, 3 },
+    { 19, 31, 44, 3, 5, 6 },
+    {  0, 20, 20, 3, 3, 3 },
+    { 27, 37, 25, 3, 3, 3 } };
+
+  for ( LabelPixelType label = 1; label <= NumberOfLabels; ++label )
+    {
+    const long *box = boxes[label - 1];
+    LabelObjectType::Pointer labelObject = LabelObjectType::New();
+    labelObject->SetLabel( label );
+    LabelMapType::IndexType idx;
+    idx[0] = box[0];
+    for ( long z = 0; z < box[5]; ++z )
+      {
+      for ( long y = 0; y < box[4]; ++y )
+        {
+        idx[1] = box[1] + y;
+        idx[2] = box[2] + z;
+        labelObject->AddLine( idx, box[3] );
+        }
+      }
+    labelMap->AddLabelObject( labelObject );
+    }
+
+  ImageType::Pointer feature = ImageType::New();
+  feature->SetRegions( region );
+  feature->SetSpacing( spacing );
+  feature->SetOrigin( origin );
+  feature->SetDirection( direction );
+  feature->Allocate();
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, region );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    const ImageType::IndexType & index = fit.GetIndex();
+    fit.Set( index[0] + 100.0 * index[1] + 10000.0 * index[2] );
+    }
+
+  typedef itk::ImageFileWriter<ImageType> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput( feature );
+  writer->SetFileName( argv[1] );
+  writer->Update();
+
+  // the crops of the feature image in memory
+  FilterType::Pointer reference = FilterType::New();
+  reference->SetInput( labelMap );
+  reference->InPlaceOff();
+  reference->SetFeatureImage( feature );
+  reference->SetPaddingOffset( 2 );
+  reference->Update();
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetPaddingOffset( 2 );
+  filter->SetFeatureImageFileName( argv[1] );
+
+  TEST_SET_GET_VALUE( std::string( argv[1] ), std::string( filter->GetFeatureImageFileName() ) );
+  TEST_SET_GET_VALUE( 268435456u, filter->GetReadMemoryBudget() );
+
+  // no ImageIO
+  TRY_EXPECT_EXCEPTION( filter->Update() );
+
+  filter->SetFeatureImageIO( itk::MetaImageIO::New() );
+
+  // the crops read one by one, a slice at a time, straight into the
+  // attribute images
+  itk::SizeValueType numberOfSlices = 0;
+  for ( LabelPixelType label = 1; label <= NumberOfLabels; ++label )
+    {
+    numberOfSlices += reference->GetOutput()->GetLabelObject( label )->GetAttributeImage()
+      ->GetBufferedRegion().GetSize( ImageDimension - 1 );
+    }
+  filter->SetReadMemoryBudget( 0 );
+  filter->Update();
+  TEST_SET_GET_VALUE( numberOfSlices, filter->GetNumberOfFeatureImageReads() );
+  if ( !CheckFileFilter( filter, reference ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // and by slabs copied with an intensity mapping
+  reference->SetShift( 1.0 );
+  reference->Update();
+  filter->SetShift( 1.0 );
+  filter->SetReadMemoryBudget( 10 * 10 * 2 * sizeof( float ) );
+  filter->Update();
+  std::cout << "Slab reads: " << filter->GetNumberOfFeatureImageReads() << std::endl;
+  TEST_EXPECT_TRUE( filter->GetNumberOfFeatureImageReads() > NumberOfLabels );
+  TEST_EXPECT_TRUE( filter->GetNumberOfFeatureImageReads() < numberOfSlices );
+  if ( !CheckFileFilter( filter, reference ) )
+    {
+    return EXIT_FAILURE;
+    }
+  reference->SetShift( 0.0 );
+  reference->Update();
+  filter->SetShift( 0.0 );
+
+  // and with the mask of the label objects
+  reference->UseLabelObjectMaskOn();
+  reference->Update();
+  filter->UseLabelObjectMaskOn();
+  filter->Update();
+  TEST_EXPECT_TRUE( filter->GetNumberOfFeatureImageReads() > NumberOfLabels );
+  TEST_EXPECT_TRUE( filter->GetNumberOfFeatureImageReads() < numberOfSlices );
+  if ( !CheckFileFilter( filter, reference ) )
+    {
+    return EXIT_FAILURE;
+    }
+  reference->UseLabelObjectMaskOff();
+  reference->Update();
+  filter->UseLabelObjectMaskOff();
+
+  // the clusters are read at once, in a single arena
+  filter->SetReadMemoryBudget( 20 * 20 * 20 * sizeof( float ) );
+  filter->ArenaAllocationOn();
+  filter->Update();
+  std::cout << "Coalesced reads: " << filter->GetNumberOfFeatureImageReads() << std::endl;
+  TEST_EXPECT_TRUE( filter->GetNumberOfFeatureImageReads() > 1 );
+  TEST_EXPECT_TRUE( filter->GetNumberOfFeatureImageReads() < NumberOfLabels );
+  if ( !CheckFileFilter( filter, reference ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // not with the views
+  filter->UseFeatureImageViewOn();
+  TRY_EXPECT_EXCEPTION( filter->Update() );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,211 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef itk::BoundingBoxImageLabelMapFilter<LabelMapType>                                               FilterType;
+
+const float DefaultValue = -1.0f;
+
+// The pixels of the masked crop are the ones of the crop scaled, inside
+// of the label object, and the default value outside. The feature value
+// encodes the index of the pixel.
+bool CheckMask( const LabelObjectType *labelObject, const ImageType *crop, const ImageType *masked, double scale )
+{
+  if ( crop->GetBufferedRegion() != masked->GetBufferedRegion()
+       || crop->GetOrigin() != masked->GetOrigin() )
+    {
+    std::cerr << "The attribute images have different geometries" << std::endl;
+    return false;
+    }
+
+  unsigned int numberInside = 0;
+  itk::ImageRegionConstIterator<ImageType> cit( crop, crop->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<ImageType> mit( masked, masked->GetBufferedRegion() );
+  for ( ; !cit.IsAtEnd(); ++cit, ++mit )
+    {
+    const long value = static_cast<long>( cit.Get() );
+    LabelMapType::IndexType idx;
+    idx[0] = value % 100;
+    idx[1] = ( value / 100 ) % 100;
+    idx[2] = value / 10000;
+
+    float expected = DefaultValue;
+    if ( labelObject->HasIndex( idx ) )
+      {
+      expected = static_cast<float>( scale * cit.Get() );
+      ++numberInside;
+      }
+    if ( mit.Get() != expected )
+      {
+      std::cerr << "Pixel at " << idx << " of label " << labelObject->GetLabel() << " is " << mit.Get()
+                << " expected " << expected << std::endl;
+      return false;
+      }
+    }
+  if ( numberInside == 0 )
+    {
+    std::cerr << "No pixel of label " << labelObject->GetLabel() << " in the masked crop" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+}
+
+int itkBoundingBoxImageLabelMapFilterTest6( int , char ** )
+{
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  LabelMapType::SizeType size;
+  size.Fill( 30 );
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+
+  // an ellipsoid, a slanted line touching the border of the image, a
+  // single pixel and a box whose lines are all clipped when shrunk
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 12.0 + 0.5 * ( idx[1] - 14.0 );
+    const double y = idx[1] - 14.0;
+    const double z = idx[2] - 15.0;
+    if ( x*x/64.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+
+  LabelObjectType::Pointer line = LabelObjectType::New();
+  line->SetLabel( 2 );
+  for ( unsigned int i = 0; i < 6; ++i )
+    {
+    LabelMapType::IndexType idx;
+    idx[0] = 22 + i;
+    idx[1] = 1 + i;
+    idx[2] = 29 - i;
+    line->AddLine( idx, 8 - i );
+    }
+  labelMap->AddLabelObject( line );
+
+  LabelObjectType::Pointer pixel = LabelObjectType::New();
+  pixel->SetLabel( 3 );
+  LabelMapType::IndexType idx;
+  idx.Fill( 3 );
+  pixel->AddIndex( idx );
+  labelMap->AddLabelObject( pixel );
+
+  LabelObjectType::Pointer box = LabelObjectType::New();
+  box->SetLabel( 4 );
+  idx[0] = 2;
+  for ( idx[2] = 2; idx[2] < 7; ++idx[2] )
+    {
+    for ( idx[1] = 20; idx[1] < 26; ++idx[1] )
+      {
+      box->AddLine( idx, 8 );
+      }
+    }
+  labelMap->AddLabelObject( box );
+
+  ImageType::Pointer feature = ImageType::New();
+  feature->SetRegions( region );
+  feature->Allocate();
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, region );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    const ImageType::IndexType & index = fit.GetIndex();
+    fit.Set( index[0] + 100.0 * index[1] + 10000.0 * index[2] );
+    }
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+
+  TEST_SET_GET_VALUE( false, filter->GetUseLabelObjectMask() );
+  TEST_SET_GET_VALUE( 0.0f, filter->GetDefaultPixelValue() );
+  filter->UseLabelObjectMaskOn();
+  filter->SetDefaultPixelValue( DefaultValue );
+  TEST_SET_GET_VALUE( true, filter->GetUseLabelObjectMask() );
+
+  // padded, then shrunk so the lines are clipped; copied, then mapped;
+  // in their own buffers, then in the arena
+  for ( int padding = 2; padding >= -1; padding -= 3 )
+    {
+    FilterType::Pointer reference = FilterType::New();
+    reference->SetInput( labelMap );
+    reference->InPlaceOff();
+    reference->SetFeatureImage( feature );
+    reference->SetPaddingOffset( padding );
+    reference->Update();
+
+    filter->SetPaddingOffset( padding );
+    for ( unsigned int mapped = 0; mapped < 2; ++mapped )
+      {
+      filter->SetScale( mapped ? 2.0 : 1.0 );
+      for ( unsigned int arena = 0; arena < 2; ++arena )
+        {
+        filter->SetArenaAllocation( arena != 0 );
+        filter->Update();
+
+        for ( LabelPixelType label = 1; label <= 4; ++label )
+          {
+          if ( !CheckMask( labelMap->GetLabelObject( label ),
+                           reference->GetOutput()->GetLabelObject( label )->GetAttributeImage(),
+                           filter->GetOutput()->GetLabelObject( label )->GetAttributeImage(),
+                           filter->GetScale() ) )
+            {
+            std::cerr << "Failed with padding " << padding << ", mapped " << mapped << ", arena " << arena
+                      << std::endl;
+            return EXIT_FAILURE;
+            }
+          }
+        }
+      }
+    }
+
+  // not with the views
+  filter->SetScale( 1.0 );
+  filter->UseFeatureImageViewOn();
+  TRY_EXPECT_EXCEPTION( filter->Update() );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxLabelMapFilter.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkLabelMap.h"
+#include "itkMultiThreader.h"
+#include "itkTimeProbe.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+// Reports the wall time of the OrientedBoundingBoxLabelMapFilter
+// against the number of threads, for a synthetic label map with a
+// skewed distribution of label object sizes: many small objects and
+// one dominant object with the largest label, so it comes last in
+// label order.
+//
+// Usage: itkLabelMapSchedulingBenchmark [numberOfSmallObjects] [largeObjectRadius] [iterations]
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef itk::SizeValueType                                                   LabelPixelType;
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                       LabelMapType;
+typedef itk::OrientedBoundingBoxLabelMapFilter<LabelMapType>                 OBBLabelMapFilterType;
+
+// Add the lines of a ball to a label object
+void AddBall( LabelObjectType *labelObject, const LabelMapType::IndexType &center, long radius )
+{
+  for ( long z = -radius; z <= radius; ++z )
+    {
+    for ( long y = -radius; y <= radius; ++y )
+      {
+      const long r2 = radius*radius - y*y - z*z;
+      if ( r2 < 0 )
+        {
+        continue;
+        }
+      long x = 0;
+      while ( (x+1)*(x+1) <= r2 )
+        {
+        ++x;
+        }
+      LabelMapType::IndexType idx = center;
+      idx[0] -= x;
+      idx[1] += y;
+      idx[2] += z;
+      labelObject->AddLine( idx, 2*x+1 );
+      }
+    }
+}
+
+LabelMapType::Pointer CreateSkewedLabelMap( unsigned int numberOfSmallObjects, long largeRadius )
+{
+  const long smallRadius = 3;
+  const long cell = 2*smallRadius+2;
+  const long objectsPerRow = 64;
+
+  LabelMapType::SizeType size;
+  size[0] = std::max( objectsPerRow*cell, 2*largeRadius+2 );
+  size[1] = std::max( ( numberOfSmallObjects/objectsPerRow + 1 )*cell, 2*largeRadius+2 );
+  size[2] = cell + 2*largeRadius + 2;
+
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+
+  for ( unsigned int i = 0; i < numberOfSmallObjects; ++i )
+    {
+    LabelObjectType::Pointer labelObject = LabelObjectType::New();
+    labelObject->SetLabel( i+1 );
+
+    LabelMapType::IndexType center;
+    center[0] = ( i % objectsPerRow )*cell + smallRadius + 1;
+    center[1] = ( i / objectsPerRow )*cell + smallRadius + 1;
+    center[2] = smallRadius + 1;
+    AddBall( labelObject, center, smallRadius );
+    labelMap->AddLabelObject( labelObject );
+    }
+
+  LabelObjectType::Pointer largeObject = LabelObjectType::New();
+  largeObject->SetLabel( numberOfSmallObjects+1 );
+  LabelMapType::IndexType center;
+  center[0] = largeRadius;
+  center[1] = largeRadius;
+  center[2] = cell + largeRadius;
+  AddBall( largeObject, center, largeRadius );
+  labelMap->AddLabelObject( largeObject );
+
+  return labelMap;
+}
+
+}
+
+int main( int argc, char *argv[] )
+{
+  const unsigned int numberOfSmallObjects = ( argc > 1 ) ? atoi( argv[1] ) : 20000;
+  const long         largeRadius = ( argc > 2 ) ? atol( argv[2] ) : 200;
+  const unsigned int iterations = ( argc > 3 ) ? atoi( argv[3] ) : 3;
+
+  LabelMapType::Pointer labelMap = CreateSkewedLabelMap( numberOfSmallObjects, largeRadius );
+
+  std::cout << "Label objects: " << labelMap->GetNumberOfLabelObjects() << std::endl;
+  std::cout << "Lines in largest object: " << labelMap->GetLabelObject( numberOfSmallObjects+1 )->GetNumberOfLines() << std::endl;
+  std::cout << std::endl;
+  std::cout << "Threads\tLabelOrder(s)\tCostOrdered(s)" << std::endl;
+
+  const itk::ThreadIdType maxThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  for ( itk::ThreadIdType threads = 1; threads <= maxThreads; threads *= 2 )
+    {
+    std::cout << threads;
+    for ( unsigned int costOrdered = 0; costOrdered < 2; ++costOrdered )
+      {
+      itk::TimeProbe probe;
+      for ( unsigned int i = 0; i < iterations; ++i )
+        {
+        OBBLabelMapFilterType::Pointer filter = OBBLabelMapFilterType::New();
+        filter->SetInput( labelMap );
+        filter->InPlaceOff();
+        filter->SetNumberOfThreads( threads );
+        filter->SetCostOrderedScheduling( costOrdered != 0 );
+
+        probe.Start();
+        filter->Update();
+        probe.Stop();
+        }
+      std::cout << "\t" << probe.GetMean();
+      }
+    std::cout << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkLabelObjectLineLookup.h"
+#include "itkLabelObject.h"
+#include <cstdlib>
+#include <iostream>
+
+int itkLabelObjectLineLookupTest( int , char ** )
+{
+  const unsigned int ImageDimension = 3;
+  typedef itk::LabelObject< unsigned int, ImageDimension > LabelObjectType;
+  typedef LabelObjectType::IndexType                       IndexType;
+
+  // unoptimized lines, out of order, nested, overlapping and adjacent
+  const long lines[][4] = {
+    { 3, 2, 1, 2 },   // nested in the next line
+    { 0, 2, 1, 11 },
+    { 5, 2, 1, 4 },   // also nested
+    { 14, 2, 1, 3 },  // adjacent to the next line
+    { 12, 2, 1, 2 },
+    { 8, 4, 1, 5 },   // overlapping the next line
+    { 4, 4, 1, 6 },
+    { 20, 4, 1, 2 },  // after a gap
+    { 1, 2, 0, 3 },
+    { 2, 2, 2, 1 } };
+  const unsigned int numberOfLines = sizeof( lines ) / sizeof( lines[0] );
+
+  LabelObjectType::Pointer labelObject = LabelObjectType::New();
+  for ( unsigned int l = 0; l < numberOfLines; ++l )
+    {
+    IndexType idx;
+    idx[0] = lines[l][0];
+    idx[1] = lines[l][1];
+    idx[2] = lines[l][2];
+    labelObject->AddLine( idx, lines[l][3] );
+    }
+
+  itk::LabelObjectLineLookup<LabelObjectType> lookup;
+  lookup.Initialize( labelObject );
+
+  unsigned int numberInside = 0;
+  IndexType idx;
+  for ( idx[2] = -1; idx[2] < 4; ++idx[2] )
+    {
+    for ( idx[1] = 0; idx[1] < 6; ++idx[1] )
+      {
+      for ( idx[0] = -2; idx[0] < 25; ++idx[0] )
+        {
+        const bool expected = labelObject->HasIndex( idx );
+        if ( lookup.IsInside( idx ) != expected )
+          {
+          std::cerr << "Index " << idx << " is " << ( expected ? "inside" : "outside" )
+                    << " of the label object" << std::endl;
+          return EXIT_FAILURE;
+          }
+        numberInside += expected;
+        }
+      }
+    }
+
+  // 16 pixels in the row y=2, z=1, 11 in y=4, z=1, and 3 and 1
+  // in the other rows
+  if ( numberInside != 31 )
+    {
+    std::cerr << "Found " << numberInside << " pixels inside, expected 31" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
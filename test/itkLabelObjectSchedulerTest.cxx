@@ -0,0 +1,262 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkScheduledLabelMapFilter.h"
+#include "itkInPlaceLabelMapFilter.h"
+#include "itkLabelObjectLineReducer.h"
+#include "itkLabelObject.h"
+#include "itkLabelMap.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+const unsigned int ImageDimension = 2;
+typedef itk::LabelObject< unsigned int, ImageDimension > LabelObjectType;
+typedef itk::LabelMap< LabelObjectType >                 LabelMapType;
+
+// Records the largest number of threads busy at the same time.
+class BusyThreads
+{
+public:
+  BusyThreads() : m_Number( 0 ), m_Maximum( 0 ) {}
+
+  void Add( int delta )
+  {
+    itk::MutexLockHolder< itk::SimpleFastMutexLock > lock( m_Mutex );
+    m_Number += delta;
+    m_Maximum = std::max( m_Maximum, m_Number );
+  }
+
+  int                      m_Number;
+  int                      m_Maximum;
+  itk::SimpleFastMutexLock m_Mutex;
+};
+
+// Counts the pixels of the lines, with some busy work so that the
+// threads overlap.
+class PixelCounter
+{
+public:
+  PixelCounter( BusyThreads *busy ) : m_Busy( busy ), m_NumberOfPixels( 0 ) {}
+
+  void operator()( const LabelObjectType::LineType &line )
+  {
+    m_Busy->Add( 1 );
+    volatile double work = 0.0;
+    for ( unsigned int i = 0; i < 2000; ++i )
+      {
+      work += i;
+      }
+    m_NumberOfPixels += line.GetLength();
+    m_Busy->Add( -1 );
+  }
+
+  void Merge( const PixelCounter &other )
+  {
+    m_NumberOfPixels += other.m_NumberOfPixels;
+  }
+
+  BusyThreads        *m_Busy;
+  itk::SizeValueType  m_NumberOfPixels;
+};
+
+// Counts the pixels of the label objects, and splits the ones with
+// at least LargeNumberOfLines lines into chunks.
+class ChunkedLabelMapFilter:
+  public itk::ScheduledLabelMapFilter< itk::InPlaceLabelMapFilter< LabelMapType > >
+{
+public:
+  typedef ChunkedLabelMapFilter                                                      Self;
+  typedef itk::ScheduledLabelMapFilter< itk::InPlaceLabelMapFilter< LabelMapType > > Superclass;
+  typedef itk::SmartPointer< Self >                                                  Pointer;
+
+  itkNewMacro(Self);
+
+  static const itk::SizeValueType LargeNumberOfLines = 100;
+
+  unsigned int                      m_FailingLabel;
+  itk::SizeValueType                m_Stride;
+  BusyThreads                       m_Busy;
+  std::vector< itk::SizeValueType > m_NumberOfPixels;
+  std::vector< unsigned int >       m_NumberOfCalls;
+
+protected:
+  ChunkedLabelMapFilter() : m_FailingLabel( 0 ), m_Stride( 1 ) {}
+
+  virtual void BeforeThreadedGenerateData() ITK_OVERRIDE
+  {
+    Superclass::BeforeThreadedGenerateData();
+    m_NumberOfPixels.assign( this->GetLabelMap()->GetNumberOfLabelObjects() + 1, 0 );
+    m_NumberOfCalls.assign( this->GetLabelMap()->GetNumberOfLabelObjects() + 1, 0 );
+  }
+
+  virtual void ThreadedProcessLabelObject( LabelObjectType *labelObject ) ITK_OVERRIDE
+  {
+    itk::ThreadIdType numberOfThreads = 1;
+    if ( labelObject->GetNumberOfLines() >= LargeNumberOfLines )
+      {
+      numberOfThreads = this->GetNumberOfThreads();
+      }
+
+    if ( labelObject->GetLabel() == m_FailingLabel )
+      {
+      FailingWork failing;
+      this->GetLabelObjectScheduler()->ProcessChunks( failing, 64 );
+      }
+
+    PixelCounter counter( &m_Busy );
+    itk::LabelObjectLineReducer< LabelObjectType, PixelCounter >::Reduce( labelObject, counter,
+                                                                         this->GetLabelObjectScheduler(),
+                                                                         numberOfThreads,
+                                                                         m_Stride );
+
+    // each label object is processed by a single thread
+    m_NumberOfPixels[labelObject->GetLabel()] = counter.m_NumberOfPixels;
+    ++m_NumberOfCalls[labelObject->GetLabel()];
+  }
+
+  class FailingWork:
+    public Superclass::LabelObjectSchedulerType::ChunkedWork
+  {
+  public:
+    virtual void ProcessChunk( itk::SizeValueType chunk ) ITK_OVERRIDE
+    {
+      if ( chunk == 3 )
+        {
+        itkGenericExceptionMacro("Failing chunk");
+        }
+    }
+  };
+};
+
+} // end namespace
+
+int itkLabelObjectSchedulerTest( int , char ** )
+{
+  LabelMapType::SizeType size;
+  size[0] = 64;
+  size[1] = 4096;
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+
+  // a large object first, then objects of decreasing size
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+
+  const unsigned int numberOfLabels = 24;
+  std::vector< itk::SizeValueType > expectedNumberOfPixels( numberOfLabels + 1, 0 );
+  LabelObjectType::IndexType idx;
+  idx[1] = 0;
+  for ( unsigned int label = 1; label <= numberOfLabels; ++label )
+    {
+    LabelObjectType::Pointer labelObject = LabelObjectType::New();
+    labelObject->SetLabel( label );
+    const unsigned int numberOfLines = ( label == 1 ) ? 2000 : 120 - 4 * label;
+    for ( unsigned int l = 0; l < numberOfLines; ++l, ++idx[1] )
+      {
+      idx[0] = l % 7;
+      labelObject->AddLine( idx, 1 + label % 5 );
+      expectedNumberOfPixels[label] += 1 + label % 5;
+      }
+    labelMap->AddLabelObject( labelObject );
+    }
+
+  const unsigned int numberOfThreads = 4;
+
+  typedef ChunkedLabelMapFilter FilterType;
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->SetNumberOfThreads( numberOfThreads );
+  filter->Update();
+
+  for ( unsigned int label = 1; label <= numberOfLabels; ++label )
+    {
+    if ( filter->m_NumberOfCalls[label] != 1 )
+      {
+      std::cerr << "Label " << label << " processed " << filter->m_NumberOfCalls[label]
+                << " times" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if ( filter->m_NumberOfPixels[label] != expectedNumberOfPixels[label] )
+      {
+      std::cerr << "Label " << label << " has " << filter->m_NumberOfPixels[label]
+                << " pixels, expected " << expectedNumberOfPixels[label] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // the chunks are processed by the threads of the filter, not by
+  // new threads
+  std::cout << "Maximum number of busy threads: " << filter->m_Busy.m_Maximum << std::endl;
+  if ( filter->m_Busy.m_Maximum > static_cast<int>( numberOfThreads ) )
+    {
+    std::cerr << "More than " << numberOfThreads << " threads were busy" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // with a stride, only every third line and the last one are
+  // reduced
+  filter->m_Stride = 3;
+  filter->Modified();
+  filter->Update();
+  for ( unsigned int label = 1; label <= numberOfLabels; ++label )
+    {
+    const itk::SizeValueType numberOfLines = labelMap->GetLabelObject( label )->GetNumberOfLines();
+    itk::SizeValueType expected = 0;
+    for ( itk::SizeValueType l = 0; l < numberOfLines; ++l )
+      {
+      if ( l % filter->m_Stride == 0 || l == numberOfLines - 1 )
+        {
+        expected += 1 + label % 5;
+        }
+      }
+    if ( filter->m_NumberOfPixels[label] != expected )
+      {
+      std::cerr << "Label " << label << " has " << filter->m_NumberOfPixels[label]
+                << " pixels with a stride, expected " << expected << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // the exception of a chunk is thrown by the thread of the object,
+  // and the other threads do not wait for it
+  filter->m_FailingLabel = 1;
+  filter->Modified();
+  bool caught = false;
+  try
+    {
+    filter->Update();
+    }
+  catch ( itk::ExceptionObject & e )
+    {
+    std::cout << "Expected exception: " << e.what() << std::endl;
+    caught = true;
+    }
+  if ( !caught )
+    {
+    std::cerr << "The exception of the failing chunk was not thrown" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
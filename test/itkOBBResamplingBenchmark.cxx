@@ -0,0 +1,198 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkLabelMap.h"
+#include "itkTimeProbe.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// Reports the wall time of the OrientedBoundingBoxImageLabelMapFilter
+// resampling a large ellipsoid, traversing the attribute image in
+// raster order and by bricks fitting in the cache, for an ellipsoid
+// aligned with the feature image, rotated by 45 degrees about two axes
+// and with a random orientation.
+//
+// Usage: itkOBBResamplingBenchmark [imageSize] [iterations] [traversalCacheSize]
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef itk::SizeValueType                                                   LabelPixelType;
+typedef itk::Image<float, ImageDimension>                                    ImageType;
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType >
+                                                                             LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                       LabelMapType;
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType>            OBBImageFilterType;
+typedef itk::Matrix<double, ImageDimension, ImageDimension>                  MatrixType;
+
+// The rotation about the z axis by angleZ followed by the rotation
+// about the x axis by angleX.
+MatrixType Rotation( double angleZ, double angleX, double angleY )
+{
+  MatrixType rz;
+  rz.SetIdentity();
+  rz(0,0) = std::cos( angleZ ); rz(0,1) = -std::sin( angleZ );
+  rz(1,0) = std::sin( angleZ ); rz(1,1) = std::cos( angleZ );
+
+  MatrixType rx;
+  rx.SetIdentity();
+  rx(1,1) = std::cos( angleX ); rx(1,2) = -std::sin( angleX );
+  rx(2,1) = std::sin( angleX ); rx(2,2) = std::cos( angleX );
+
+  MatrixType ry;
+  ry.SetIdentity();
+  ry(0,0) = std::cos( angleY ); ry(0,2) = std::sin( angleY );
+  ry(2,0) = -std::sin( angleY ); ry(2,2) = std::cos( angleY );
+
+  return ry * rx * rz;
+}
+
+// A label map with a single ellipsoid centered in the image, whose
+// axes are the columns of rotation.
+LabelMapType::Pointer CreateEllipsoidLabelMap( long size, const MatrixType &rotation )
+{
+  LabelMapType::SizeType imageSize;
+  imageSize.Fill( size );
+  LabelMapType::RegionType region;
+  region.SetSize( imageSize );
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+
+  // the quadratic form of the ellipsoid, R diag(1/a^2) R^T
+  const double axes[ImageDimension] = { 0.4 * size, 0.25 * size, 0.15 * size };
+  MatrixType form;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      form(i,j) = 0.0;
+      for ( unsigned int k = 0; k < ImageDimension; ++k )
+        {
+        form(i,j) += rotation(i,k) * rotation(j,k) / ( axes[k] * axes[k] );
+        }
+      }
+    }
+
+  LabelObjectType::Pointer labelObject = LabelObjectType::New();
+  labelObject->SetLabel( 1 );
+
+  // the range of x on each row, solving the quadratic in x
+  const double center = 0.5 * ( size - 1 );
+  for ( long z = 0; z < size; ++z )
+    {
+    for ( long y = 0; y < size; ++y )
+      {
+      const double dy = y - center;
+      const double dz = z - center;
+      const double a = form(0,0);
+      const double b = 2.0 * ( form(0,1) * dy + form(0,2) * dz );
+      const double c = form(1,1) * dy * dy + 2.0 * form(1,2) * dy * dz + form(2,2) * dz * dz - 1.0;
+      const double discriminant = b * b - 4.0 * a * c;
+      if ( discriminant < 0.0 )
+        {
+        continue;
+        }
+      const long begin = std::max( 0L, static_cast<long>( std::ceil( center + ( -b - std::sqrt( discriminant ) ) / ( 2.0 * a ) ) ) );
+      const long end = std::min( size - 1, static_cast<long>( std::floor( center + ( -b + std::sqrt( discriminant ) ) / ( 2.0 * a ) ) ) );
+      if ( end < begin )
+        {
+        continue;
+        }
+      LabelMapType::IndexType idx;
+      idx[0] = begin;
+      idx[1] = y;
+      idx[2] = z;
+      labelObject->AddLine( idx, end - begin + 1 );
+      }
+    }
+  labelMap->AddLabelObject( labelObject );
+
+  return labelMap;
+}
+
+}
+
+int main( int argc, char *argv[] )
+{
+  const long          size = ( argc > 1 ) ? atol( argv[1] ) : 512;
+  const unsigned int  iterations = ( argc > 2 ) ? atoi( argv[2] ) : 3;
+  const itk::SizeValueType cacheSize = ( argc > 3 ) ? atol( argv[3] ) : 262144;
+
+  ImageType::SizeType imageSize;
+  imageSize.Fill( size );
+  ImageType::RegionType region;
+  region.SetSize( imageSize );
+
+  ImageType::Pointer feature = ImageType::New();
+  feature->SetRegions( region );
+  feature->Allocate();
+  feature->FillBuffer( 1.0f );
+
+  const double pi = std::acos( -1.0 );
+  std::srand( 1 );
+  const double randomZ = 2.0 * pi * std::rand() / RAND_MAX;
+  const double randomX = 2.0 * pi * std::rand() / RAND_MAX;
+  const double randomY = 2.0 * pi * std::rand() / RAND_MAX;
+
+  const char *names[3] = { "0", "45", "random" };
+  MatrixType rotations[3];
+  rotations[0] = Rotation( 0.0, 0.0, 0.0 );
+  rotations[1] = Rotation( pi / 4.0, pi / 4.0, 0.0 );
+  rotations[2] = Rotation( randomZ, randomX, randomY );
+
+  std::cout << "Image size: " << size << "^3" << std::endl;
+  std::cout << "TraversalCacheSize: " << cacheSize << std::endl;
+  std::cout << std::endl;
+  std::cout << "Orientation\tRaster(s)\tBricks(s)" << std::endl;
+
+  for ( unsigned int r = 0; r < 3; ++r )
+    {
+    LabelMapType::Pointer labelMap = CreateEllipsoidLabelMap( size, rotations[r] );
+
+    std::cout << names[r];
+    for ( unsigned int bricks = 0; bricks < 2; ++bricks )
+      {
+      itk::TimeProbe probe;
+      for ( unsigned int i = 0; i < iterations; ++i )
+        {
+        OBBImageFilterType::Pointer filter = OBBImageFilterType::New();
+        filter->SetInput( labelMap );
+        filter->InPlaceOff();
+        filter->SetFeatureImage( feature );
+        filter->SetTraversalCacheSize( bricks ? cacheSize : 0 );
+
+        probe.Start();
+        filter->Update();
+        probe.Stop();
+        }
+      std::cout << "\t" << probe.GetMean();
+      }
+    std::cout << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,249 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+#include "itkOrientedBoundingBoxImageLabelMapFilterTestHelpers.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+
+const float DefaultValue = -1000.0f;
+
+// A nearest neighbor interpolator counting its instances, which are
+// the clones made by the filter.
+class CountingInterpolator:
+  public itk::NearestNeighborInterpolateImageFunction< ImageType, double >
+{
+public:
+  typedef CountingInterpolator                                              Self;
+  typedef itk::NearestNeighborInterpolateImageFunction< ImageType, double > Superclass;
+  typedef itk::SmartPointer< Self >                                         Pointer;
+
+  itkNewMacro(Self);
+
+  static unsigned int m_NumberOfInstances;
+  static itk::SimpleFastMutexLock m_Mutex;
+
+protected:
+  CountingInterpolator()
+  {
+    itk::MutexLockHolder< itk::SimpleFastMutexLock > lock( m_Mutex );
+    ++m_NumberOfInstances;
+  }
+};
+
+unsigned int CountingInterpolator::m_NumberOfInstances = 0;
+itk::SimpleFastMutexLock CountingInterpolator::m_Mutex;
+
+// Check each pixel of the attribute image against the ramp, or the
+// nearest feature pixel, or the default value outside of the feature
+// image. The half pixel border where the linear interpolator clamps
+// the neighbors is skipped.
+bool CheckAttributeImage( const ImageType *attributeImage, const ImageType *feature, bool nearest,
+                          unsigned int &numberInside, unsigned int &numberOutside )
+{
+  const ImageType::SizeType & featureSize = feature->GetLargestPossibleRegion().GetSize();
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it( attributeImage, attributeImage->GetBufferedRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::PointType point;
+    attributeImage->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    itk::ContinuousIndex<double, ImageDimension> cindex;
+    feature->TransformPhysicalPointToContinuousIndex( point, cindex );
+
+    bool inside = true;
+    bool outside = false;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      inside = inside && cindex[i] >= 0.0 && cindex[i] <= featureSize[i] - 1.0;
+      outside = outside || cindex[i] < -0.5 - 1e-6 || cindex[i] > featureSize[i] - 0.5 + 1e-6;
+      }
+
+    if ( inside )
+      {
+      ++numberInside;
+      double expected = Ramp( point );
+      if ( nearest )
+        {
+        ImageType::IndexType nearestIndex;
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          nearestIndex[i] = static_cast<itk::IndexValueType>( std::floor( cindex[i] + 0.5 ) );
+          }
+        expected = feature->GetPixel( nearestIndex );
+        }
+      if ( std::abs( it.Get() - expected ) > 1e-3 )
+        {
+        std::cerr << "Pixel " << it.GetIndex() << " is " << it.Get() << " expected " << expected << std::endl;
+        return false;
+        }
+      }
+    else if ( outside )
+      {
+      ++numberOutside;
+      if ( it.Get() != DefaultValue )
+        {
+        std::cerr << "Pixel " << it.GetIndex() << " outside of the feature image is " << it.Get() << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+}
+
+int itkOrientedBoundingBoxImageLabelMapFilterTest3( int , char ** )
+{
+  // A slanted ellipsoid crossing the border of a smaller, rotated
+  // feature image.
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  SetGeometry( labelMap.GetPointer(), 40, 0.3 );
+  labelMap->Allocate();
+
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  const LabelMapType::RegionType region = labelMap->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 20.0 + 0.5 * ( idx[1] - 20.0 );
+    const double y = idx[1] - 20.0;
+    const double z = idx[2] - 20.0 + 0.3 * ( idx[0] - 20.0 );
+    if ( x*x/256.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+
+  LabelObjectType::Pointer line = LabelObjectType::New();
+  line->SetLabel( 2 );
+  LabelMapType::IndexType idx;
+  idx.Fill( 8 );
+  line->AddLine( idx, 12 );
+  labelMap->AddLabelObject( line );
+
+  ImageType::Pointer feature = ImageType::New();
+  SetGeometry( feature.GetPointer(), 30, -0.2 );
+  ImageType::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = 2.75;
+  feature->SetOrigin( origin );
+  feature->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, feature->GetBufferedRegion() );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    ImageType::PointType point;
+    feature->TransformIndexToPhysicalPoint( fit.GetIndex(), point );
+    fit.Set( Ramp( point ) );
+    }
+
+  typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType> FilterType;
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->SetFeatureImage( feature );
+  filter->SetDefaultPixelValue( DefaultValue );
+
+  FilterType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.75;
+  spacing[2] = 1.0;
+  filter->SetAttributeImageSpacing( spacing );
+
+  TEST_SET_GET_VALUE( 262144u, filter->GetLargeAttributeImageNumberOfPixels() );
+  TEST_SET_GET_VALUE( 262144u, filter->GetTraversalCacheSize() );
+
+  // the default linear interpolator in raster order, then by small
+  // bricks, then a nearest neighbor one, with the attribute images
+  // split across the threads
+  const unsigned int numberOfThreads = 4;
+  filter->SetNumberOfThreads( numberOfThreads );
+  for ( unsigned int pass = 0; pass < 3; ++pass )
+    {
+    const bool nearest = ( pass == 2 );
+    if ( pass == 0 )
+      {
+      filter->SetTraversalCacheSize( 0 );
+      }
+    else if ( pass == 1 )
+      {
+      filter->SetTraversalCacheSize( 2048 );
+      }
+    else
+      {
+      filter->SetInterpolator( CountingInterpolator::New() );
+      filter->SetLargeAttributeImageNumberOfPixels( 1 );
+      CountingInterpolator::m_NumberOfInstances = 0;
+      }
+    filter->Update();
+
+    // the slabs reuse the interpolators of the threads
+    if ( nearest )
+      {
+      TEST_SET_GET_VALUE( numberOfThreads, CountingInterpolator::m_NumberOfInstances );
+      }
+
+    unsigned int numberInside = 0;
+    unsigned int numberOutside = 0;
+    for ( LabelPixelType label = 1; label <= 2; ++label )
+      {
+      const LabelObjectType *labelObject = filter->GetOutput()->GetLabelObject( label );
+      const ImageType *attributeImage = labelObject->GetAttributeImage();
+
+      TEST_EXPECT_TRUE( attributeImage != ITK_NULLPTR );
+      TEST_SET_GET_VALUE( spacing, attributeImage->GetSpacing() );
+      TEST_SET_GET_VALUE( labelObject->GetOrientedBoundingBoxDirection(), attributeImage->GetDirection() );
+
+      if ( !CheckAttributeImage( attributeImage, feature, nearest, numberInside, numberOutside ) )
+        {
+        std::cerr << "Label " << label << " failed" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+
+    std::cout << "Checked " << numberInside << " inside and " << numberOutside << " outside pixels" << std::endl;
+    TEST_EXPECT_TRUE( numberInside > 0 );
+    TEST_EXPECT_TRUE( numberOutside > 0 );
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef LabelObjectType::MaskImageType                                                                  MaskImageType;
+
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType> FilterType;
+
+const float DefaultValue = -1.0f;
+
+// A thin diagonal cylinder, and a label object made of unsorted lines.
+LabelMapType::Pointer CreateLabelMap()
+{
+  LabelMapType::SizeType size;
+  size.Fill( 40 );
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+  LabelMapType::SpacingType spacing;
+  spacing[0] = 1.0;
+  spacing[1] = 0.8;
+  spacing[2] = 1.2;
+  labelMap->SetSpacing( spacing );
+  labelMap->Allocate();
+
+  LabelObjectType::Pointer cylinder = LabelObjectType::New();
+  cylinder->SetLabel( 1 );
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    // distance to the line through (2,2,2) along (1,1,1)
+    const double d[3] = { idx[0] - 2.0, idx[1] - 2.0, idx[2] - 2.0 };
+    const double t = ( d[0] + d[1] + d[2] ) / 3.0;
+    const double r2 = ( d[0]-t )*( d[0]-t ) + ( d[1]-t )*( d[1]-t ) + ( d[2]-t )*( d[2]-t );
+    if ( t >= 0.0 && t <= 34.0 && r2 <= 4.0 )
+      {
+      cylinder->AddIndex( idx );
+      }
+    }
+  cylinder->Optimize();
+  labelMap->AddLabelObject( cylinder );
+
+  LabelObjectType::Pointer lines = LabelObjectType::New();
+  lines->SetLabel( 2 );
+  LabelMapType::IndexType idx;
+  idx[0] = 30; idx[1] = 6; idx[2] = 5;
+  lines->AddLine( idx, 6 );
+  idx[0] = 32; idx[1] = 4; idx[2] = 4;
+  lines->AddLine( idx, 4 );
+  idx[0] = 27; idx[1] = 6; idx[2] = 6;
+  lines->AddLine( idx, 7 );
+  idx[0] = 26; idx[1] = 5; idx[2] = 4;
+  lines->AddLine( idx, 5 );
+  idx[0] = 28; idx[1] = 4; idx[2] = 4;
+  lines->AddLine( idx, 3 );
+  idx[0] = 29; idx[1] = 5; idx[2] = 5;
+  lines->AddLine( idx, 4 );
+  labelMap->AddLabelObject( lines );
+
+  return labelMap;
+}
+
+ImageType::Pointer CreateFeatureImage( const LabelMapType *labelMap )
+{
+  ImageType::Pointer feature = ImageType::New();
+  feature->SetRegions( labelMap->GetLargestPossibleRegion() );
+  feature->SetSpacing( labelMap->GetSpacing() );
+  feature->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it( feature, feature->GetBufferedRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const ImageType::IndexType & idx = it.GetIndex();
+    it.Set( 10.0 + idx[0] + 2.0 * idx[1] + 3.0 * idx[2] );
+    }
+  return feature;
+}
+
+}
+
+int itkOrientedBoundingBoxImageLabelMapFilterTest4( int , char ** )
+{
+  FilterType::Pointer filter = FilterType::New();
+
+  TEST_SET_GET_VALUE( false, filter->GetUseLabelObjectMask() );
+  filter->UseLabelObjectMaskOn();
+  TEST_SET_GET_VALUE( true, filter->GetUseLabelObjectMask() );
+  filter->UseLabelObjectMaskOff();
+
+  TEST_SET_GET_VALUE( false, filter->GetGenerateMaskImage() );
+  filter->GenerateMaskImageOn();
+  TEST_SET_GET_VALUE( true, filter->GetGenerateMaskImage() );
+  filter->GenerateMaskImageOff();
+
+  // reference without the mask
+  LabelMapType::Pointer labelMap = CreateLabelMap();
+  ImageType::Pointer feature = CreateFeatureImage( labelMap );
+
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+  filter->SetDefaultPixelValue( DefaultValue );
+  filter->Update();
+  LabelMapType::Pointer reference = filter->GetOutput();
+
+  // only the mask image, then the mask applied to the interpolation
+  // with the attribute images split across the threads
+  for ( unsigned int useMask = 0; useMask < 2; ++useMask )
+    {
+    FilterType::Pointer maskFilter = FilterType::New();
+    maskFilter->SetInput( labelMap );
+    maskFilter->InPlaceOff();
+    maskFilter->SetFeatureImage( feature );
+    maskFilter->SetDefaultPixelValue( DefaultValue );
+    maskFilter->SetUseLabelObjectMask( useMask );
+    maskFilter->GenerateMaskImageOn();
+    maskFilter->SetLargeAttributeImageNumberOfPixels( useMask ? 1 : 0 );
+    maskFilter->Update();
+
+    for ( LabelPixelType label = 1; label <= 2; ++label )
+      {
+      const LabelObjectType *labelObject = maskFilter->GetOutput()->GetLabelObject( label );
+      const ImageType *attributeImage = labelObject->GetAttributeImage();
+      const MaskImageType *maskImage = labelObject->GetMaskImage();
+      const ImageType *referenceImage = reference->GetLabelObject( label )->GetAttributeImage();
+
+      TEST_EXPECT_TRUE( maskImage != ITK_NULLPTR );
+      TEST_EXPECT_TRUE( maskImage->GetBufferedRegion() == attributeImage->GetBufferedRegion() );
+      TEST_EXPECT_TRUE( referenceImage->GetBufferedRegion() == attributeImage->GetBufferedRegion() );
+
+      unsigned int numberInside = 0;
+      itk::ImageRegionConstIteratorWithIndex<ImageType> it( attributeImage, attributeImage->GetBufferedRegion() );
+      for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+        {
+        ImageType::PointType point;
+        attributeImage->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+        LabelMapType::IndexType labelIndex;
+        labelMap->TransformPhysicalPointToIndex( point, labelIndex );
+        const bool inside = labelMap->GetLabelObject( label )->HasIndex( labelIndex );
+
+        if ( ( maskImage->GetPixel( it.GetIndex() ) != 0 ) != inside )
+          {
+          std::cerr << "Label " << label << " mask differs at " << it.GetIndex() << std::endl;
+          return EXIT_FAILURE;
+          }
+
+        const float expected = ( inside || !useMask ) ? referenceImage->GetPixel( it.GetIndex() ) : DefaultValue;
+        if ( it.Get() != expected )
+          {
+          std::cerr << "Label " << label << " pixel " << it.GetIndex() << " is " << it.Get()
+                    << " expected " << expected << std::endl;
+          return EXIT_FAILURE;
+          }
+        numberInside += inside;
+        }
+
+      std::cout << "Label " << label << ": " << numberInside << " of "
+                << attributeImage->GetBufferedRegion().GetNumberOfPixels() << " pixels inside" << std::endl;
+      TEST_EXPECT_TRUE( numberInside > 0 );
+      TEST_EXPECT_TRUE( numberInside < attributeImage->GetBufferedRegion().GetNumberOfPixels() );
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType>                                       FilterType;
+
+// A feature image with a rotated direction and a non linear content,
+// so the interpolation weights matter.
+ImageType::Pointer CreateFeatureImage( double angle, double originShift, double frequency )
+{
+  ImageType::Pointer image = ImageType::New();
+
+  ImageType::SizeType size;
+  size.Fill( 30 );
+  ImageType::RegionType region;
+  region.SetSize( size );
+  image->SetRegions( region );
+
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.3;
+  image->SetSpacing( spacing );
+
+  ImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction(0,0) = std::cos( angle );
+  direction(0,1) = -std::sin( angle );
+  direction(1,0) = std::sin( angle );
+  direction(1,1) = std::cos( angle );
+  image->SetDirection( direction );
+
+  ImageType::PointType origin;
+  origin[0] = 4.25 + originShift;
+  origin[1] = 1.5;
+  origin[2] = 2.75 - originShift;
+  image->SetOrigin( origin );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::PointType p;
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), p );
+    it.Set( 100.0 * std::sin( frequency * p[0] ) * std::cos( 0.5 * frequency * p[1] ) + 3.0 * p[2] );
+    }
+  return image;
+}
+
+bool CompareImages( const ImageType *expected, const ImageType *result )
+{
+  if ( expected->GetBufferedRegion() != result->GetBufferedRegion()
+       || expected->GetOrigin() != result->GetOrigin() )
+    {
+    std::cerr << "The attribute images have different geometries" << std::endl;
+    return false;
+    }
+
+  itk::ImageRegionConstIterator<ImageType> eit( expected, expected->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<ImageType> rit( result, result->GetBufferedRegion() );
+  for ( ; !eit.IsAtEnd(); ++eit, ++rit )
+    {
+    if ( std::abs( eit.Get() - rit.Get() ) > 1e-3 )
+      {
+      std::cerr << "Pixel is " << rit.Get() << " expected " << eit.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+// Compare each attribute image of the multi feature filter with the
+// one of a filter run on this feature image alone.
+bool CheckFeatureImages( LabelMapType *labelMap, const std::vector<ImageType::Pointer> &features,
+                         bool nearest, itk::SizeValueType largeNumberOfPixels )
+{
+  typedef itk::NearestNeighborInterpolateImageFunction< ImageType, double > NearestInterpolatorType;
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetDefaultPixelValue( -1000.0f );
+  filter->SetLargeAttributeImageNumberOfPixels( largeNumberOfPixels );
+  if ( nearest )
+    {
+    filter->SetInterpolator( NearestInterpolatorType::New() );
+    }
+  for ( unsigned int f = 0; f < features.size(); ++f )
+    {
+    filter->SetNthFeatureImage( f, features[f] );
+    }
+  if ( filter->GetNumberOfFeatureImages() != features.size() )
+    {
+    std::cerr << "Wrong number of feature images " << filter->GetNumberOfFeatureImages() << std::endl;
+    return false;
+    }
+  if ( filter->GetNthFeatureImage( 0 ) != filter->GetFeatureImage() )
+    {
+    std::cerr << "The first feature image is not the FeatureImage input" << std::endl;
+    return false;
+    }
+  filter->Update();
+
+  for ( unsigned int f = 0; f < features.size(); ++f )
+    {
+    FilterType::Pointer single = FilterType::New();
+    single->SetInput( labelMap );
+    single->InPlaceOff();
+    single->SetFeatureImage( features[f] );
+    single->SetDefaultPixelValue( -1000.0f );
+    if ( nearest )
+      {
+      single->SetInterpolator( NearestInterpolatorType::New() );
+      }
+    single->Update();
+
+    for ( LabelPixelType label = 1; label <= 2; ++label )
+      {
+      const LabelObjectType *labelObject = filter->GetOutput()->GetLabelObject( label );
+      if ( labelObject->GetNumberOfAttributeImages() != features.size() )
+        {
+        std::cerr << "Label " << label << " has " << labelObject->GetNumberOfAttributeImages()
+                  << " attribute images" << std::endl;
+        return false;
+        }
+      if ( !CompareImages( single->GetOutput()->GetLabelObject( label )->GetAttributeImage(),
+                           labelObject->GetNthAttributeImage( f ) ) )
+        {
+        std::cerr << "Label " << label << " feature image " << f << " failed" << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+}
+
+int itkOrientedBoundingBoxImageLabelMapFilterTest5( int , char ** )
+{
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  LabelMapType::SizeType size;
+  size.Fill( 40 );
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 20.0 + 0.5 * ( idx[1] - 20.0 );
+    const double y = idx[1] - 20.0;
+    const double z = idx[2] - 20.0 + 0.3 * ( idx[0] - 20.0 );
+    if ( x*x/256.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+
+  LabelObjectType::Pointer line = LabelObjectType::New();
+  line->SetLabel( 2 );
+  LabelMapType::IndexType idx;
+  idx.Fill( 8 );
+  line->AddLine( idx, 12 );
+  labelMap->AddLabelObject( line );
+
+  // two feature images on the same grid and one on another grid
+  std::vector<ImageType::Pointer> features;
+  features.push_back( CreateFeatureImage( -0.2, 0.0, 0.3 ) );
+  features.push_back( CreateFeatureImage( -0.2, 0.0, 0.7 ) );
+  features.push_back( CreateFeatureImage( 0.1, 1.75, 0.5 ) );
+
+  std::vector<ImageType::Pointer> sameGeometry( features.begin(), features.begin() + 2 );
+
+  for ( unsigned int nearest = 0; nearest < 2; ++nearest )
+    {
+    if ( !CheckFeatureImages( labelMap, features, nearest, 0 )
+         || !CheckFeatureImages( labelMap, features, nearest, 1 )
+         || !CheckFeatureImages( labelMap, sameGeometry, nearest, 0 )
+         || !CheckFeatureImages( labelMap, sameGeometry, nearest, 1 ) )
+      {
+      std::cerr << "Failed with the " << ( nearest ? "nearest neighbor" : "linear" ) << " interpolator" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+#include "itkOrientedBoundingBoxImageLabelMapFilterTestHelpers.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType>                                       FilterType;
+
+// Compare the slot of the batch with the attribute image, pixel by
+// pixel in the same order.
+template< class TBatchImage, class TImage >
+bool CompareSlot( const TBatchImage *batch, itk::SizeValueType slot, const TImage *image )
+{
+  itk::SizeValueType numberOfPixels = 1;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    if ( batch->GetBufferedRegion().GetSize( i ) != image->GetBufferedRegion().GetSize( i ) )
+      {
+      std::cerr << "The attribute image size " << image->GetBufferedRegion().GetSize()
+                << " is not the size of the patch" << std::endl;
+      return false;
+      }
+    numberOfPixels *= image->GetBufferedRegion().GetSize( i );
+    }
+
+  const typename TBatchImage::PixelType *patch = batch->GetBufferPointer() + slot * numberOfPixels;
+  itk::ImageRegionConstIterator<TImage> it( image, image->GetBufferedRegion() );
+  for ( itk::SizeValueType n = 0; !it.IsAtEnd(); ++it, ++n )
+    {
+    if ( std::abs( static_cast<double>( it.Get() ) - static_cast<double>( patch[n] ) ) > 1e-3 )
+      {
+      std::cerr << "Patch pixel " << n << " of slot " << slot << " is " << static_cast<double>( patch[n] )
+                << " expected " << static_cast<double>( it.Get() ) << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkOrientedBoundingBoxImageLabelMapFilterTest6( int , char ** )
+{
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  SetGeometry( labelMap.GetPointer(), 40, 0.3 );
+  labelMap->Allocate();
+
+  // a slanted ellipsoid crossing the border of the feature image, a
+  // rotated box and a single pixel
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 3 );
+  LabelObjectType::Pointer box = LabelObjectType::New();
+  box->SetLabel( 7 );
+  const LabelMapType::RegionType region = labelMap->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 20.0 + 0.5 * ( idx[1] - 20.0 );
+    const double y = idx[1] - 20.0;
+    const double z = idx[2] - 20.0 + 0.3 * ( idx[0] - 20.0 );
+    if ( x*x/256.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    else if ( std::abs( idx[0] + idx[1] - 60.0 ) <= 4.0 && std::abs( idx[0] - idx[1] - 10.0 ) <= 2.0 && idx[2] < 6 )
+      {
+      box->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  box->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+  labelMap->AddLabelObject( box );
+
+  LabelObjectType::Pointer pixel = LabelObjectType::New();
+  pixel->SetLabel( 11 );
+  LabelMapType::IndexType idx;
+  idx.Fill( 4 );
+  pixel->AddIndex( idx );
+  labelMap->AddLabelObject( pixel );
+
+  ImageType::Pointer feature = ImageType::New();
+  SetGeometry( feature.GetPointer(), 30, -0.2 );
+  ImageType::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = 2.75;
+  feature->SetOrigin( origin );
+  feature->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, feature->GetBufferedRegion() );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    ImageType::PointType p;
+    feature->TransformIndexToPhysicalPoint( fit.GetIndex(), p );
+    fit.Set( 100.0 * std::sin( 0.4 * p[0] ) * std::cos( 0.2 * p[1] ) + 3.0 * p[2] );
+    }
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+  filter->SetDefaultPixelValue( -1000.0f );
+  filter->GenerateMaskImageOn();
+
+  FilterType::SizeType patchSize;
+  patchSize[0] = 16;
+  patchSize[1] = 12;
+  patchSize[2] = 8;
+
+  FilterType::SizeType zeroSize;
+  zeroSize.Fill( 0 );
+  TEST_SET_GET_VALUE( zeroSize, filter->GetBatchPatchSize() );
+  filter->SetBatchPatchSize( patchSize );
+  TEST_SET_GET_VALUE( patchSize, filter->GetBatchPatchSize() );
+
+  // serial, then split across the threads
+  for ( unsigned int split = 0; split < 2; ++split )
+    {
+    filter->SetLargeAttributeImageNumberOfPixels( split ? 1 : 0 );
+    filter->Update();
+
+    const FilterType::BatchLabelArrayType & labels = filter->GetBatchLabels();
+    TEST_EXPECT_TRUE( labels.size() == 3 && labels[0] == 3 && labels[1] == 7 && labels[2] == 11 );
+
+    const FilterType::BatchImageType *batch = filter->GetBatchImage();
+    const FilterType::BatchMaskImageType *batchMask = filter->GetBatchMaskImage();
+    TEST_EXPECT_TRUE( batch != ITK_NULLPTR );
+    TEST_EXPECT_TRUE( batchMask != ITK_NULLPTR );
+    TEST_EXPECT_TRUE( filter->GetBatchImage( 1 ) == ITK_NULLPTR );
+    TEST_SET_GET_VALUE( labels.size(), batch->GetBufferedRegion().GetSize( ImageDimension ) );
+
+    for ( itk::SizeValueType slot = 0; slot < labels.size(); ++slot )
+      {
+      const LabelObjectType *labelObject = filter->GetOutput()->GetLabelObject( labels[slot] );
+      TEST_SET_GET_VALUE( 0u, labelObject->GetNumberOfAttributeImages() );
+
+      // The patch of the label object is the attribute image with the
+      // spacing set from the size of the box. Along the axes where the
+      // padded box is flat, as for the single pixel, the patch is
+      // centered on the box with the default spacing of 1, which is
+      // the attribute image of a box padded to the size of the patch.
+      FilterType::SpacingType spacing;
+      FilterType::SpacingType padding;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        const double extent = labelObject->GetOrientedBoundingBoxSize()[i] - 1.0;
+        if ( extent > 0.0 )
+          {
+          spacing[i] = extent / ( patchSize[i] - 1 );
+          padding[i] = -0.5;
+          }
+        else
+          {
+          spacing[i] = 1.0;
+          padding[i] = 0.5 * ( ( patchSize[i] - 1 ) - labelObject->GetOrientedBoundingBoxSize()[i] );
+          }
+        }
+
+      FilterType::Pointer reference = FilterType::New();
+      reference->SetInput( labelMap );
+      reference->InPlaceOff();
+      reference->SetFeatureImage( feature );
+      reference->SetDefaultPixelValue( -1000.0f );
+      reference->GenerateMaskImageOn();
+      reference->SetAttributeImageSpacing( spacing );
+      reference->SetPaddingOffset( padding );
+      reference->Update();
+
+      const LabelObjectType *referenceObject = reference->GetOutput()->GetLabelObject( labels[slot] );
+      if ( !CompareSlot( batch, slot, referenceObject->GetAttributeImage().GetPointer() )
+           || !CompareSlot( batchMask, slot, referenceObject->GetMaskImage() ) )
+        {
+        std::cerr << "Label " << labels[slot] << " failed" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,237 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+#include "itkOrientedBoundingBoxImageLabelMapFilterTestHelpers.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType>                                       FilterType;
+
+const float DefaultValue = -1000.0f;
+
+// Check that the k-th slice is on the grid of the full attribute
+// image, through the centroid, and that its pixels are the scaled ramp
+// inside of the feature image and the default value outside.
+bool CheckSlice( const LabelObjectType *labelObject, const ImageType *full, const ImageType *slice,
+                 unsigned int k, const ImageType *feature, double scale, unsigned int &numberInside )
+{
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    const itk::SizeValueType expectedSize = ( i == k ) ? 1 : full->GetBufferedRegion().GetSize( i );
+    if ( slice->GetBufferedRegion().GetSize( i ) != expectedSize )
+      {
+      std::cerr << "Slice " << k << " has size " << slice->GetBufferedRegion().GetSize() << std::endl;
+      return false;
+      }
+    }
+  if ( slice->GetSpacing() != full->GetSpacing() || slice->GetDirection() != full->GetDirection() )
+    {
+    std::cerr << "Slice " << k << " is not on the grid of the attribute image" << std::endl;
+    return false;
+    }
+
+  const ImageType::SizeType & featureSize = feature->GetLargestPossibleRegion().GetSize();
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it( slice, slice->GetBufferedRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::PointType point;
+    slice->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+
+    // on the plane through the centroid normal to the k-th axis, and
+    // on the grid of the attribute image along the other axes
+    ImageType::PointType fullPoint;
+    ImageType::IndexType fullIndex = it.GetIndex();
+    full->TransformIndexToPhysicalPoint( fullIndex, fullPoint );
+    double distance = 0.0;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      distance += labelObject->GetOrientedBoundingBoxDirection()(i,k) * ( point[i] - labelObject->GetCentroid()[i] );
+      }
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      if ( j == k )
+        {
+        continue;
+        }
+      double along = 0.0;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        along += labelObject->GetOrientedBoundingBoxDirection()(i,j) * ( point[i] - fullPoint[i] );
+        }
+      distance = std::abs( distance ) + std::abs( along );
+      }
+    if ( std::abs( distance ) > 1e-6 )
+      {
+      std::cerr << "Pixel " << it.GetIndex() << " of slice " << k << " is off the plane by " << distance << std::endl;
+      return false;
+      }
+
+    itk::ContinuousIndex<double, ImageDimension> cindex;
+    feature->TransformPhysicalPointToContinuousIndex( point, cindex );
+    bool inside = true;
+    bool outside = false;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      inside = inside && cindex[i] >= 0.0 && cindex[i] <= featureSize[i] - 1.0;
+      outside = outside || cindex[i] < -0.5 - 1e-6 || cindex[i] > featureSize[i] - 0.5 + 1e-6;
+      }
+
+    if ( inside )
+      {
+      ++numberInside;
+      if ( std::abs( it.Get() - scale * Ramp( point ) ) > 1e-3 * scale )
+        {
+        std::cerr << "Pixel " << it.GetIndex() << " of slice " << k << " is " << it.Get()
+                  << " expected " << scale * Ramp( point ) << std::endl;
+        return false;
+        }
+      }
+    else if ( outside && it.Get() != DefaultValue )
+      {
+      std::cerr << "Pixel " << it.GetIndex() << " of slice " << k << " outside of the feature image is "
+                << it.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkOrientedBoundingBoxImageLabelMapFilterTest7( int , char ** )
+{
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  SetGeometry( labelMap.GetPointer(), 40, 0.3 );
+  labelMap->Allocate();
+
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  const LabelMapType::RegionType region = labelMap->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 20.0 + 0.5 * ( idx[1] - 20.0 );
+    const double y = idx[1] - 20.0;
+    const double z = idx[2] - 20.0 + 0.3 * ( idx[0] - 20.0 );
+    if ( x*x/256.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+
+  // two feature images on the same grid, the second one twice the
+  // first one
+  ImageType::Pointer features[2];
+  for ( unsigned int f = 0; f < 2; ++f )
+    {
+    features[f] = ImageType::New();
+    SetGeometry( features[f].GetPointer(), 30, -0.2 );
+    ImageType::PointType origin;
+    origin[0] = 4.25;
+    origin[1] = 1.5;
+    origin[2] = 2.75;
+    features[f]->SetOrigin( origin );
+    features[f]->Allocate();
+
+    itk::ImageRegionIteratorWithIndex<ImageType> fit( features[f], features[f]->GetBufferedRegion() );
+    for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+      {
+      ImageType::PointType point;
+      features[f]->TransformIndexToPhysicalPoint( fit.GetIndex(), point );
+      fit.Set( ( f + 1 ) * Ramp( point ) );
+      }
+    }
+
+  FilterType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.75;
+  spacing[2] = 1.0;
+
+  FilterType::Pointer reference = FilterType::New();
+  reference->SetInput( labelMap );
+  reference->InPlaceOff();
+  reference->SetFeatureImage( features[0] );
+  reference->SetAttributeImageSpacing( spacing );
+  reference->Update();
+  const ImageType *full = reference->GetOutput()->GetLabelObject( 1 )->GetAttributeImage();
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetNthFeatureImage( 0, features[0] );
+  filter->SetNthFeatureImage( 1, features[1] );
+  filter->SetDefaultPixelValue( DefaultValue );
+  filter->SetAttributeImageSpacing( spacing );
+
+  TEST_SET_GET_VALUE( false, filter->GetPrincipalPlanes() );
+  filter->PrincipalPlanesOn();
+  TEST_SET_GET_VALUE( true, filter->GetPrincipalPlanes() );
+
+  // serial, then split across the threads
+  for ( unsigned int split = 0; split < 2; ++split )
+    {
+    filter->SetLargeAttributeImageNumberOfPixels( split ? 1 : 0 );
+    filter->Update();
+
+    const LabelObjectType *labelObject = filter->GetOutput()->GetLabelObject( 1 );
+    TEST_SET_GET_VALUE( 2u * ImageDimension, labelObject->GetNumberOfAttributeImages() );
+
+    unsigned int numberInside = 0;
+    for ( unsigned int f = 0; f < 2; ++f )
+      {
+      for ( unsigned int k = 0; k < ImageDimension; ++k )
+        {
+        if ( !CheckSlice( labelObject, full, labelObject->GetNthAttributeImage( f * ImageDimension + k ),
+                          k, features[f], f + 1.0, numberInside ) )
+          {
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    std::cout << "Checked " << numberInside << " inside pixels" << std::endl;
+    TEST_EXPECT_TRUE( numberInside > 0 );
+    }
+
+  // not with the batch mode
+  FilterType::SizeType patchSize;
+  patchSize.Fill( 8 );
+  filter->SetBatchPatchSize( patchSize );
+  TRY_EXPECT_EXCEPTION( filter->Update() );
+
+  return EXIT_SUCCESS;
+}
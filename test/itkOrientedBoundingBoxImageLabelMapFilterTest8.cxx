@@ -0,0 +1,217 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+#include "itkOrientedBoundingBoxImageLabelMapFilterTestHelpers.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension >                           OBBLabelObjectType;
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                  LabelMapType;
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType>                                       FilterType;
+
+const float DefaultValue = -1000.0f;
+
+// Project the full attribute image along the axis, skipping the
+// pixels set to the default value, and compare with the projected
+// attribute image.
+bool CheckProjection( const ImageType *full, const ImageType *projected, unsigned int axis,
+                      FilterType::ProjectionType projection )
+{
+  ImageType::SizeType size = full->GetBufferedRegion().GetSize();
+  const itk::SizeValueType length = size[axis];
+  size[axis] = 1;
+  if ( projected->GetBufferedRegion().GetSize() != size
+       || projected->GetOrigin() != full->GetOrigin()
+       || projected->GetSpacing() != full->GetSpacing()
+       || projected->GetDirection() != full->GetDirection() )
+    {
+    std::cerr << "The projected image is not the projected grid" << std::endl;
+    return false;
+    }
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it( projected, projected->GetBufferedRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    ImageType::IndexType idx = it.GetIndex();
+    unsigned int count = 0;
+    double expected = 0.0;
+    for ( itk::SizeValueType n = 0; n < length; ++n )
+      {
+      idx[axis] = n;
+      const double value = full->GetPixel( idx );
+      if ( value == DefaultValue )
+        {
+        continue;
+        }
+      if ( count == 0 )
+        {
+        expected = value;
+        }
+      else if ( projection == FilterType::MaximumProjection )
+        {
+        expected = std::max( expected, value );
+        }
+      else if ( projection == FilterType::MinimumProjection )
+        {
+        expected = std::min( expected, value );
+        }
+      else
+        {
+        expected += value;
+        }
+      ++count;
+      }
+    if ( count == 0 )
+      {
+      expected = DefaultValue;
+      }
+    else if ( projection == FilterType::MeanProjection )
+      {
+      expected /= count;
+      }
+
+    if ( std::abs( it.Get() - expected ) > 1e-3 + 1e-5 * std::abs( expected ) )
+      {
+      std::cerr << "Projected pixel " << it.GetIndex() << " is " << it.Get() << " expected " << expected << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkOrientedBoundingBoxImageLabelMapFilterTest8( int , char ** )
+{
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  SetGeometry( labelMap.GetPointer(), 40, 0.3 );
+  labelMap->Allocate();
+
+  // a slanted ellipsoid crossing the border of the feature image
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  const LabelMapType::RegionType region = labelMap->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const LabelMapType::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 20.0 + 0.5 * ( idx[1] - 20.0 );
+    const double y = idx[1] - 20.0;
+    const double z = idx[2] - 20.0 + 0.3 * ( idx[0] - 20.0 );
+    if ( x*x/256.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+
+  ImageType::Pointer feature = ImageType::New();
+  SetGeometry( feature.GetPointer(), 30, -0.2 );
+  ImageType::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = 2.75;
+  feature->SetOrigin( origin );
+  feature->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, feature->GetBufferedRegion() );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    ImageType::PointType p;
+    feature->TransformIndexToPhysicalPoint( fit.GetIndex(), p );
+    fit.Set( 100.0 * std::sin( 0.4 * p[0] ) * std::cos( 0.2 * p[1] ) + 3.0 * p[2] );
+    }
+
+  FilterType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.75;
+  spacing[2] = 1.0;
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+  filter->SetDefaultPixelValue( DefaultValue );
+  filter->SetAttributeImageSpacing( spacing );
+
+  TEST_SET_GET_VALUE( FilterType::NoProjection, filter->GetProjection() );
+  TEST_SET_GET_VALUE( 0u, filter->GetProjectionAxis() );
+
+  const FilterType::ProjectionType projections[4] =
+    { FilterType::MaximumProjection, FilterType::MinimumProjection,
+      FilterType::MeanProjection, FilterType::SumProjection };
+
+  for ( unsigned int mask = 0; mask < 2; ++mask )
+    {
+    FilterType::Pointer reference = FilterType::New();
+    reference->SetInput( labelMap );
+    reference->InPlaceOff();
+    reference->SetFeatureImage( feature );
+    reference->SetDefaultPixelValue( DefaultValue );
+    reference->SetAttributeImageSpacing( spacing );
+    reference->SetUseLabelObjectMask( mask != 0 );
+    reference->Update();
+    const ImageType *full = reference->GetOutput()->GetLabelObject( 1 )->GetAttributeImage();
+
+    filter->SetUseLabelObjectMask( mask != 0 );
+    for ( unsigned int axis = 0; axis < ImageDimension; axis += 2 )
+      {
+      filter->SetProjectionAxis( axis );
+      for ( unsigned int p = 0; p < 4; ++p )
+        {
+        filter->SetProjection( projections[p] );
+        // serial, then split across the threads
+        for ( unsigned int split = 0; split < 2; ++split )
+          {
+          filter->SetLargeAttributeImageNumberOfPixels( split ? 1 : 0 );
+          filter->Update();
+
+          const LabelObjectType *labelObject = filter->GetOutput()->GetLabelObject( 1 );
+          TEST_SET_GET_VALUE( 1u, labelObject->GetNumberOfAttributeImages() );
+          if ( !CheckProjection( full, labelObject->GetAttributeImage(), axis, projections[p] ) )
+            {
+            std::cerr << "Projection " << projections[p] << " along " << axis << " failed, mask "
+                      << mask << ", split " << split << std::endl;
+            return EXIT_FAILURE;
+            }
+          }
+        }
+      }
+    }
+
+  // not along an axis of the box
+  filter->SetProjectionAxis( ImageDimension );
+  TRY_EXPECT_EXCEPTION( filter->Update() );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxImageLabelMapFilter.h"
+#include "itkAttributeImageLabelObject.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+#include "itkOrientedBoundingBoxImageLabelMapFilterTestHelpers.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                  LabelPixelType;
+typedef itk::Image<float, ImageDimension>             ImageType;
+typedef itk::Image<unsigned char, ImageDimension>     CharImageType;
+
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > OBBLabelObjectType;
+
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, ImageType, OBBLabelObjectType >     LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                                                      LabelMapType;
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<LabelMapType>                                           FilterType;
+
+typedef itk::AttributeImageLabelObject< LabelPixelType, ImageDimension, CharImageType, OBBLabelObjectType > CharLabelObjectType;
+typedef itk::LabelMap<CharLabelObjectType>                                                                  CharLabelMapType;
+typedef itk::OrientedBoundingBoxImageLabelMapFilter<CharLabelMapType, ImageType>                            CharFilterType;
+
+const float         DefaultValue = -1000.0f;
+const unsigned char CharDefaultValue = 0;
+const unsigned char OutputMinimum = 10;
+const unsigned char OutputMaximum = 240;
+const double        WindowMinimum = -20.0;
+const double        WindowMaximum = 80.0;
+
+template< class TLabelMap >
+typename TLabelMap::Pointer CreateLabelMap()
+{
+  typedef typename TLabelMap::LabelObjectType LabelObjectType;
+
+  typename TLabelMap::Pointer labelMap = TLabelMap::New();
+  SetGeometry( labelMap.GetPointer(), 40, 0.3 );
+  labelMap->Allocate();
+
+  typename LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  const typename TLabelMap::RegionType region = labelMap->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    const typename TLabelMap::IndexType idx = region.ComputeIndex( i );
+    const double x = idx[0] - 20.0 + 0.5 * ( idx[1] - 20.0 );
+    const double y = idx[1] - 20.0;
+    const double z = idx[2] - 20.0 + 0.3 * ( idx[0] - 20.0 );
+    if ( x*x/256.0 + y*y/36.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+  return labelMap;
+}
+
+// The float attribute image windowed onto the output range by hand,
+// the default value of the float image giving the default value of the
+// char image.
+bool CheckMapping( const ImageType *expected, const CharImageType *result )
+{
+  if ( expected->GetBufferedRegion() != result->GetBufferedRegion()
+       || expected->GetOrigin() != result->GetOrigin() )
+    {
+    std::cerr << "The attribute images have different geometries" << std::endl;
+    return false;
+    }
+
+  const double scale = ( OutputMaximum - OutputMinimum ) / ( WindowMaximum - WindowMinimum );
+
+  unsigned int numberClamped = 0;
+  itk::ImageRegionConstIterator<ImageType>     eit( expected, expected->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<CharImageType> rit( result, result->GetBufferedRegion() );
+  for ( ; !eit.IsAtEnd(); ++eit, ++rit )
+    {
+    double value = CharDefaultValue;
+    if ( eit.Get() != DefaultValue )
+      {
+      value = ( eit.Get() - WindowMinimum ) * scale + OutputMinimum;
+      if ( value <= OutputMinimum || value >= OutputMaximum )
+        {
+        ++numberClamped;
+        }
+      value = std::max( static_cast<double>( OutputMinimum ), std::min( static_cast<double>( OutputMaximum ), value ) );
+      }
+    // the float image is rounded before the mapping
+    if ( std::abs( std::floor( value ) - rit.Get() ) > 1.0 )
+      {
+      std::cerr << "Pixel is " << static_cast<int>( rit.Get() ) << " expected " << value << std::endl;
+      return false;
+      }
+    }
+  std::cout << "Checked " << numberClamped << " clamped pixels" << std::endl;
+  return numberClamped > 0;
+}
+
+}
+
+int itkOrientedBoundingBoxImageLabelMapFilterTest9( int , char ** )
+{
+  LabelMapType::Pointer labelMap = CreateLabelMap<LabelMapType>();
+  CharLabelMapType::Pointer charLabelMap = CreateLabelMap<CharLabelMapType>();
+
+  ImageType::Pointer feature = ImageType::New();
+  SetGeometry( feature.GetPointer(), 30, -0.2 );
+  ImageType::PointType origin;
+  origin[0] = 4.25;
+  origin[1] = 1.5;
+  origin[2] = 2.75;
+  feature->SetOrigin( origin );
+  feature->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> fit( feature, feature->GetBufferedRegion() );
+  for ( fit.GoToBegin(); !fit.IsAtEnd(); ++fit )
+    {
+    ImageType::PointType p;
+    feature->TransformIndexToPhysicalPoint( fit.GetIndex(), p );
+    fit.Set( 100.0 * std::sin( 0.4 * p[0] ) * std::cos( 0.2 * p[1] ) + 3.0 * p[2] );
+    }
+
+  CharFilterType::Pointer filter = CharFilterType::New();
+  filter->SetInput( charLabelMap );
+  filter->InPlaceOff();
+  filter->SetFeatureImage( feature );
+  filter->SetDefaultPixelValue( CharDefaultValue );
+
+  TEST_SET_GET_VALUE( 0.0, filter->GetShift() );
+  TEST_SET_GET_VALUE( 1.0, filter->GetScale() );
+  TEST_SET_GET_VALUE( 0, filter->GetOutputMinimum() );
+  TEST_SET_GET_VALUE( 255, filter->GetOutputMaximum() );
+
+  filter->SetOutputMinimum( OutputMinimum );
+  filter->SetOutputMaximum( OutputMaximum );
+  filter->SetIntensityWindow( WindowMinimum, WindowMaximum );
+  TEST_SET_GET_VALUE( 2.3, filter->GetScale() );
+  TEST_EXPECT_TRUE( std::abs( filter->GetShift() - ( OutputMinimum / 2.3 - WindowMinimum ) ) < 1e-12 );
+
+  TRY_EXPECT_EXCEPTION( filter->SetIntensityWindow( 5.0, 5.0 ) );
+
+  // the whole box, then the mean projection
+  for ( unsigned int projection = 0; projection < 2; ++projection )
+    {
+    FilterType::Pointer reference = FilterType::New();
+    reference->SetInput( labelMap );
+    reference->InPlaceOff();
+    reference->SetFeatureImage( feature );
+    reference->SetDefaultPixelValue( DefaultValue );
+    reference->SetProjection( projection ? FilterType::MeanProjection : FilterType::NoProjection );
+    reference->Update();
+
+    filter->SetProjection( projection ? CharFilterType::MeanProjection : CharFilterType::NoProjection );
+    // serial, then split across the threads
+    for ( unsigned int split = 0; split < 2; ++split )
+      {
+      filter->SetLargeAttributeImageNumberOfPixels( split ? 1 : 0 );
+      filter->Update();
+
+      if ( !CheckMapping( reference->GetOutput()->GetLabelObject( 1 )->GetAttributeImage(),
+                          filter->GetOutput()->GetLabelObject( 1 )->GetAttributeImage() ) )
+        {
+        std::cerr << "Failed with projection " << projection << ", split " << split << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
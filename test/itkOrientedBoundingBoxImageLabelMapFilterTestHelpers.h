@@ -0,0 +1,65 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkOrientedBoundingBoxImageLabelMapFilterTestHelpers_h
+#define itkOrientedBoundingBoxImageLabelMapFilterTestHelpers_h
+
+// The geometry and the feature values shared by the tests of
+// OrientedBoundingBoxImageLabelMapFilter.
+
+#include <cmath>
+
+namespace
+{
+
+// A linear function of the physical point, which the linear
+// interpolation reproduces inside of the image.
+template< class TPoint >
+double Ramp( const TPoint &p )
+{
+  return 200.0 + 2.0 * p[0] + 3.0 * p[1] - p[2];
+}
+
+// A cube of size pixels with anisotropic spacing, rotated by angle
+// about the last axis.
+template< class TImage >
+void SetGeometry( TImage *image, unsigned int size, double angle )
+{
+  typename TImage::SizeType imageSize;
+  imageSize.Fill( size );
+  typename TImage::RegionType region;
+  region.SetSize( imageSize );
+  image->SetRegions( region );
+
+  typename TImage::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.3;
+  image->SetSpacing( spacing );
+
+  typename TImage::DirectionType direction;
+  direction.SetIdentity();
+  direction(0,0) = std::cos( angle );
+  direction(0,1) = -std::sin( angle );
+  direction(1,0) = std::sin( angle );
+  direction(1,1) = std::cos( angle );
+  image->SetDirection( direction );
+}
+
+}
+
+#endif
@@ -46,5 +46,44 @@ int itkOrientedBoundingBoxLabelMapFilterTest1( int , char ** )
 
   EXERCISE_BASIC_OBJECT_METHODS( labelMapFilter, LabelMapFilterType );
 
+  TEST_SET_GET_VALUE( 65536u, labelMapFilter->GetLargeLabelObjectNumberOfLines() );
+  labelMapFilter->SetLargeLabelObjectNumberOfLines( 100 );
+  TEST_SET_GET_VALUE( 100u, labelMapFilter->GetLargeLabelObjectNumberOfLines() );
+
+  TEST_SET_GET_VALUE( 16u, labelMapFilter->GetSmallLabelObjectNumberOfLines() );
+  labelMapFilter->SetSmallLabelObjectNumberOfLines( 0 );
+  TEST_SET_GET_VALUE( 0u, labelMapFilter->GetSmallLabelObjectNumberOfLines() );
+
+  TEST_SET_GET_VALUE( false, labelMapFilter->GetAlignSingleLinesWithImageAxes() );
+  labelMapFilter->AlignSingleLinesWithImageAxesOn();
+  TEST_SET_GET_VALUE( true, labelMapFilter->GetAlignSingleLinesWithImageAxes() );
+  labelMapFilter->AlignSingleLinesWithImageAxesOff();
+
+  TEST_SET_GET_VALUE( true, labelMapFilter->GetCostOrderedScheduling() );
+  labelMapFilter->CostOrderedSchedulingOff();
+  TEST_SET_GET_VALUE( false, labelMapFilter->GetCostOrderedScheduling() );
+
+  TEST_SET_GET_VALUE( false, labelMapFilter->GetComputeMinimumVolume() );
+  labelMapFilter->ComputeMinimumVolumeOn();
+  TEST_SET_GET_VALUE( true, labelMapFilter->GetComputeMinimumVolume() );
+
+  TEST_SET_GET_VALUE( 32u, labelMapFilter->GetMinimumVolumeSearchDirections() );
+  labelMapFilter->SetMinimumVolumeSearchDirections( 64 );
+  TEST_SET_GET_VALUE( 64u, labelMapFilter->GetMinimumVolumeSearchDirections() );
+
+  TEST_SET_GET_VALUE( 1u, labelMapFilter->GetDecimationFactor() );
+  labelMapFilter->SetDecimationFactor( 0 );
+  TEST_SET_GET_VALUE( 1u, labelMapFilter->GetDecimationFactor() );
+  labelMapFilter->SetDecimationFactor( 4 );
+  TEST_SET_GET_VALUE( 4u, labelMapFilter->GetDecimationFactor() );
+
+  TEST_SET_GET_VALUE( false, labelMapFilter->GetRefineApproximation() );
+  labelMapFilter->RefineApproximationOn();
+  TEST_SET_GET_VALUE( true, labelMapFilter->GetRefineApproximation() );
+
+  TEST_SET_GET_VALUE( 0.0, labelMapFilter->GetApproximationTolerance() );
+  labelMapFilter->SetApproximationTolerance( 0.5 );
+  TEST_SET_GET_VALUE( 0.5, labelMapFilter->GetApproximationTolerance() );
+
   return EXIT_SUCCESS;
 }
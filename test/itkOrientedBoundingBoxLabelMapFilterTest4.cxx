@@ -0,0 +1,201 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxLabelMapFilter.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkLabelMap.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                                         LabelPixelType;
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                       LabelMapType;
+typedef itk::OrientedBoundingBoxLabelMapFilter<LabelMapType>                 OBBLabelMapFilterType;
+
+// Label 1 is a single pixel, label 2 a single line and label 3 a
+// small object of three lines, in an image rotated about z with
+// anisotropic spacing.
+LabelMapType::Pointer CreateLabelMap()
+{
+  LabelMapType::SizeType size;
+  size.Fill( 20 );
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+
+  LabelMapType::SpacingType spacing;
+  spacing[0] = 0.7;
+  spacing[1] = 1.3;
+  spacing[2] = 2.1;
+  labelMap->SetSpacing( spacing );
+
+  const double c = std::cos( 0.6 );
+  const double s = std::sin( 0.6 );
+  LabelMapType::DirectionType direction;
+  direction.SetIdentity();
+  direction(0,0) = c;
+  direction(0,1) = -s;
+  direction(1,0) = s;
+  direction(1,1) = c;
+  labelMap->SetDirection( direction );
+  labelMap->Allocate();
+
+  LabelMapType::IndexType idx;
+
+  LabelObjectType::Pointer pixel = LabelObjectType::New();
+  pixel->SetLabel( 1 );
+  idx.Fill( 3 );
+  pixel->AddIndex( idx );
+  labelMap->AddLabelObject( pixel );
+
+  LabelObjectType::Pointer line = LabelObjectType::New();
+  line->SetLabel( 2 );
+  idx.Fill( 6 );
+  line->AddLine( idx, 7 );
+  labelMap->AddLabelObject( line );
+
+  LabelObjectType::Pointer small = LabelObjectType::New();
+  small->SetLabel( 3 );
+  idx.Fill( 10 );
+  small->AddLine( idx, 4 );
+  idx[1] += 1;
+  small->AddLine( idx, 5 );
+  idx[2] += 1;
+  small->AddLine( idx, 3 );
+  labelMap->AddLabelObject( small );
+
+  return labelMap;
+}
+
+bool CheckSize( const LabelObjectType *labelObject, const double expected[] )
+{
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    if ( std::abs( labelObject->GetOrientedBoundingBoxSize()[i] - expected[i] ) > 1e-10 )
+      {
+      std::cerr << "Label " << labelObject->GetLabel() << " OBB size "
+                << labelObject->GetOrientedBoundingBoxSize() << " expected "
+                << expected[0] << " " << expected[1] << " " << expected[2] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int itkOrientedBoundingBoxLabelMapFilterTest4( int , char ** )
+{
+  LabelMapType::Pointer labelMap = CreateLabelMap();
+
+  OBBLabelMapFilterType::Pointer reference = OBBLabelMapFilterType::New();
+  reference->SetInput( labelMap );
+  reference->InPlaceOff();
+  reference->SetSmallLabelObjectNumberOfLines( 0 );
+  reference->Update();
+
+  for ( unsigned int minimumVolume = 0; minimumVolume < 2; ++minimumVolume )
+    {
+    OBBLabelMapFilterType::Pointer filter = OBBLabelMapFilterType::New();
+    filter->SetInput( labelMap );
+    filter->InPlaceOff();
+    filter->SetComputeMinimumVolume( minimumVolume != 0 );
+    filter->AlignSingleLinesWithImageAxesOn();
+    filter->Update();
+
+    // the exact boxes of the pixels, aligned with the image axes
+    // instead of the principal axes and sorted by increasing extent
+    const double pixelSize[] = { 0.7, 1.3, 2.1 };
+    if ( !CheckSize( filter->GetOutput()->GetLabelObject( 1 ), pixelSize ) )
+      {
+      return EXIT_FAILURE;
+      }
+    const double lineSize[] = { 1.3, 2.1, 4.9 };
+    if ( !CheckSize( filter->GetOutput()->GetLabelObject( 2 ), lineSize ) )
+      {
+      return EXIT_FAILURE;
+      }
+
+    // the box of the line is centered on it and its direction is a
+    // proper rotation
+    const LabelObjectType *line = filter->GetOutput()->GetLabelObject( 2 );
+    const LabelObjectType::OBBDirectionType &direction = line->GetOrientedBoundingBoxDirection();
+    const double det = direction(0,0) * ( direction(1,1) * direction(2,2) - direction(1,2) * direction(2,1) )
+      - direction(0,1) * ( direction(1,0) * direction(2,2) - direction(1,2) * direction(2,0) )
+      + direction(0,2) * ( direction(1,0) * direction(2,1) - direction(1,1) * direction(2,0) );
+    if ( std::abs( det - 1.0 ) > 1e-10 )
+      {
+      std::cerr << "OBB direction is not a rotation: " << direction << std::endl;
+      return EXIT_FAILURE;
+      }
+    LabelObjectType::OBBPointType center = line->GetOrientedBoundingBoxOrigin();
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+        center[i] += 0.5 * direction(i,j) * line->GetOrientedBoundingBoxSize()[j];
+        }
+      if ( std::abs( center[i] - line->GetCentroid()[i] ) > 1e-10 )
+        {
+        std::cerr << "OBB of the line is not centered on its centroid" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // by default the small path is the same as the general one, also
+  // for the single pixel and the single line, whose boxes stay
+  // aligned with their principal axes
+  OBBLabelMapFilterType::Pointer filter = OBBLabelMapFilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->Update();
+
+  for ( LabelPixelType label = 1; label <= 3; ++label )
+    {
+    const LabelObjectType *expected = reference->GetOutput()->GetLabelObject( label );
+    const LabelObjectType *labelObject = filter->GetOutput()->GetLabelObject( label );
+    if ( !CheckSize( labelObject, expected->GetOrientedBoundingBoxSize().GetDataPointer() ) )
+      {
+      return EXIT_FAILURE;
+      }
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+        if ( std::abs( labelObject->GetOrientedBoundingBoxDirection()(i,j)
+                       - expected->GetOrientedBoundingBoxDirection()(i,j) ) > 1e-10 )
+          {
+          std::cerr << "Label " << label << " OBB direction " << labelObject->GetOrientedBoundingBoxDirection()
+                    << " expected " << expected->GetOrientedBoundingBoxDirection() << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
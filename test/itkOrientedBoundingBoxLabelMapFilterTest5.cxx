@@ -0,0 +1,176 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkOrientedBoundingBoxLabelMapFilter.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkLabelMap.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                                         LabelPixelType;
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                       LabelMapType;
+typedef itk::OrientedBoundingBoxLabelMapFilter<LabelMapType>                 OBBLabelMapFilterType;
+
+// A slanted ellipsoid, whose extremes along the principal axes are
+// not all in the decimated lines.
+LabelMapType::Pointer CreateLabelMap()
+{
+  LabelMapType::SizeType size;
+  size.Fill( 48 );
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+
+  LabelMapType::SpacingType spacing;
+  spacing[0] = 1.0;
+  spacing[1] = 1.0;
+  spacing[2] = 1.5;
+  labelMap->SetSpacing( spacing );
+  labelMap->Allocate();
+
+  LabelObjectType::Pointer labelObject = LabelObjectType::New();
+  labelObject->SetLabel( 1 );
+  LabelMapType::IndexType idx;
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    idx = region.ComputeIndex( i );
+    const double x = idx[0] - 24.0 + 0.5 * ( idx[2] - 24.0 );
+    const double y = idx[1] - 24.0 - 0.3 * ( idx[0] - 24.0 );
+    const double z = idx[2] - 24.0;
+    if ( x*x/144.0 + y*y/49.0 + z*z/225.0 <= 1.0 )
+      {
+      labelObject->AddIndex( idx );
+      }
+    }
+  labelObject->Optimize();
+  labelMap->AddLabelObject( labelObject );
+
+  return labelMap;
+}
+
+const LabelObjectType * ComputeOBB( LabelMapType *labelMap,
+                                    OBBLabelMapFilterType::Pointer &filter,
+                                    unsigned int decimationFactor,
+                                    bool refine,
+                                    double tolerance )
+{
+  filter = OBBLabelMapFilterType::New();
+  filter->SetInput( labelMap );
+  filter->InPlaceOff();
+  filter->SetDecimationFactor( decimationFactor );
+  filter->SetRefineApproximation( refine );
+  filter->SetApproximationTolerance( tolerance );
+  filter->Update();
+
+  const LabelObjectType *labelObject = filter->GetOutput()->GetLabelObject( 1 );
+  std::cout << "Decimation " << decimationFactor << " refine " << refine << " tolerance " << tolerance
+            << " OBB size: " << labelObject->GetOrientedBoundingBoxSize()
+            << " error bound: " << labelObject->GetOrientedBoundingBoxErrorBound() << std::endl;
+  return labelObject;
+}
+
+}
+
+int itkOrientedBoundingBoxLabelMapFilterTest5( int , char ** )
+{
+  LabelMapType::Pointer labelMap = CreateLabelMap();
+
+  OBBLabelMapFilterType::Pointer exactFilter;
+  const LabelObjectType *exact = ComputeOBB( labelMap, exactFilter, 1, false, 0.0 );
+
+  const double tolerance = 1e-9;
+
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    if ( exact->GetOrientedBoundingBoxErrorBound()[i] != 0.0 )
+      {
+      std::cerr << "The exact box has a non zero error bound" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  for ( unsigned int decimationFactor = 2; decimationFactor <= 8; decimationFactor *= 2 )
+    {
+    OBBLabelMapFilterType::Pointer approximateFilter;
+    const LabelObjectType *approximate = ComputeOBB( labelMap, approximateFilter, decimationFactor, false, 0.0 );
+
+    // The principal axes are the same, so the approximate box is
+    // inside the exact one, and the exact one is inside the
+    // approximate one grown by the error bound.
+    bool positive = false;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      const double approximateSize = approximate->GetOrientedBoundingBoxSize()[i];
+      const double exactSize = exact->GetOrientedBoundingBoxSize()[i];
+      const double errorBound = approximate->GetOrientedBoundingBoxErrorBound()[i];
+      if ( approximateSize > exactSize + tolerance )
+        {
+        std::cerr << "The approximate box is larger than the exact one" << std::endl;
+        return EXIT_FAILURE;
+        }
+      if ( exactSize > approximateSize + errorBound + tolerance )
+        {
+        std::cerr << "The error bound does not hold along axis " << i << std::endl;
+        return EXIT_FAILURE;
+        }
+      positive = positive || errorBound > 0.0;
+      }
+    if ( !positive )
+      {
+      std::cerr << "Expected a positive error bound" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // the objects above the tolerance are computed again from all the
+    // lines
+    OBBLabelMapFilterType::Pointer refinedFilter;
+    const LabelObjectType *refined = ComputeOBB( labelMap, refinedFilter, decimationFactor, true, 0.0 );
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      if ( refined->GetOrientedBoundingBoxErrorBound()[i] != 0.0
+           || std::abs( refined->GetOrientedBoundingBoxSize()[i] - exact->GetOrientedBoundingBoxSize()[i] ) > tolerance )
+        {
+        std::cerr << "The refined box is not the exact box" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+
+    // and the objects within the tolerance are left approximate
+    OBBLabelMapFilterType::Pointer toleratedFilter;
+    const LabelObjectType *tolerated = ComputeOBB( labelMap, toleratedFilter, decimationFactor, true, 1000.0 );
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      if ( tolerated->GetOrientedBoundingBoxErrorBound()[i] != approximate->GetOrientedBoundingBoxErrorBound()[i] )
+        {
+        std::cerr << "The box within the tolerance was refined" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -39,5 +39,12 @@ int itkOrientedBoundingBoxLabelObjectTest( int , char ** )
 
   // todo test set/get methods...
 
+  LabelObject1Type::OBBSizeType errorBound;
+  errorBound.Fill( 0.0 );
+  TEST_SET_GET_VALUE( errorBound, labelObject1->GetOrientedBoundingBoxErrorBound() );
+  errorBound[1] = 2.5;
+  labelObject1->SetOrientedBoundingBoxErrorBound( errorBound );
+  TEST_SET_GET_VALUE( errorBound, labelObject1->GetOrientedBoundingBoxErrorBound() );
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,221 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkPrincipalMomentsLabelMapFilter.h"
+#include "itkOrientedBoundingBoxLabelMapFilter.h"
+#include "itkShapeLabelMapFilter.h"
+#include "itkOrientedBoundingBoxLabelObject.h"
+#include "itkLabelMap.h"
+#include <cstdlib>
+#include <cmath>
+
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+const unsigned int ImageDimension = 3;
+typedef unsigned int                                                       LabelPixelType;
+typedef itk::OrientedBoundingBoxLabelObject< LabelPixelType, ImageDimension > LabelObjectType;
+typedef itk::LabelMap<LabelObjectType>                                       LabelMapType;
+
+// A label map with anisotropic spacing and a rotated direction, with
+// a slanted ellipsoid, a single line and a single pixel object.
+LabelMapType::Pointer CreateLabelMap()
+{
+  LabelMapType::SizeType size;
+  size.Fill( 40 );
+  LabelMapType::RegionType region;
+  region.SetSize( size );
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+
+  LabelMapType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 1.25;
+  spacing[2] = 2.0;
+  labelMap->SetSpacing( spacing );
+
+  LabelMapType::PointType origin;
+  origin[0] = -3.0;
+  origin[1] = 7.0;
+  origin[2] = 11.0;
+  labelMap->SetOrigin( origin );
+
+  LabelMapType::DirectionType direction;
+  direction.Fill( 0.0 );
+  direction(0,1) = 1.0;
+  direction(1,0) = -1.0;
+  direction(2,2) = 1.0;
+  labelMap->SetDirection( direction );
+  labelMap->Allocate();
+
+  LabelObjectType::Pointer ellipsoid = LabelObjectType::New();
+  ellipsoid->SetLabel( 1 );
+  LabelMapType::IndexType idx;
+  for ( unsigned int i = 0; i < region.GetNumberOfPixels(); ++i )
+    {
+    idx = region.ComputeIndex( i );
+    const double x = idx[0] - 20.0 + 0.4 * ( idx[1] - 20.0 );
+    const double y = idx[1] - 20.0;
+    const double z = idx[2] - 20.0 + 0.3 * ( idx[0] - 20.0 );
+    if ( x*x/225.0 + y*y/64.0 + z*z/16.0 <= 1.0 )
+      {
+      ellipsoid->AddIndex( idx );
+      }
+    }
+  ellipsoid->Optimize();
+  labelMap->AddLabelObject( ellipsoid );
+
+  LabelObjectType::Pointer line = LabelObjectType::New();
+  line->SetLabel( 2 );
+  idx.Fill( 2 );
+  line->AddLine( idx, 9 );
+  labelMap->AddLabelObject( line );
+
+  LabelObjectType::Pointer pixel = LabelObjectType::New();
+  pixel->SetLabel( 3 );
+  idx.Fill( 37 );
+  pixel->AddIndex( idx );
+  labelMap->AddLabelObject( pixel );
+
+  return labelMap;
+}
+
+bool AlmostEqual( double a, double b )
+{
+  return std::abs( a - b ) <= 1e-8 * ( 1.0 + std::abs( a ) + std::abs( b ) );
+}
+
+bool CompareLabelObjects( const LabelObjectType *expected, const LabelObjectType *result )
+{
+  bool pass = expected->GetNumberOfPixels() == result->GetNumberOfPixels()
+    && expected->GetBoundingBox() == result->GetBoundingBox()
+    && AlmostEqual( expected->GetPhysicalSize(), result->GetPhysicalSize() );
+
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    pass = pass && AlmostEqual( expected->GetCentroid()[i], result->GetCentroid()[i] );
+    pass = pass && AlmostEqual( expected->GetPrincipalMoments()[i], result->GetPrincipalMoments()[i] );
+
+    // the principal axes are only defined up to sign, and not at all
+    // for repeated moments
+    if ( i > 0 && AlmostEqual( expected->GetPrincipalMoments()[i], expected->GetPrincipalMoments()[i-1] ) )
+      {
+      continue;
+      }
+    if ( i+1 < ImageDimension && AlmostEqual( expected->GetPrincipalMoments()[i], expected->GetPrincipalMoments()[i+1] ) )
+      {
+      continue;
+      }
+    double dot = 0.0;
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      dot += expected->GetPrincipalAxes()(i,j) * result->GetPrincipalAxes()(i,j);
+      }
+    pass = pass && AlmostEqual( std::abs( dot ), 1.0 );
+    }
+
+  if ( !pass )
+    {
+    std::cerr << "Label " << expected->GetLabel() << " differs:" << std::endl;
+    std::cerr << "Expected: " << std::endl;
+    expected->Print( std::cerr );
+    std::cerr << "Result: " << std::endl;
+    result->Print( std::cerr );
+    }
+  return pass;
+}
+
+}
+
+int itkPrincipalMomentsLabelMapFilterTest( int , char ** )
+{
+  typedef itk::ShapeLabelMapFilter<LabelMapType>            ShapeFilterType;
+  typedef itk::PrincipalMomentsLabelMapFilter<LabelMapType> MomentsFilterType;
+
+  LabelMapType::Pointer labelMap = CreateLabelMap();
+
+  MomentsFilterType::Pointer moments = MomentsFilterType::New();
+
+  EXERCISE_BASIC_OBJECT_METHODS( moments, MomentsFilterType );
+
+  TEST_SET_GET_VALUE( 65536u, moments->GetLargeLabelObjectNumberOfLines() );
+
+  ShapeFilterType::Pointer shape = ShapeFilterType::New();
+  shape->SetInput( labelMap );
+  shape->InPlaceOff();
+  shape->Update();
+
+  // check the serial and the split accumulation
+  for ( unsigned int split = 0; split < 2; ++split )
+    {
+    moments = MomentsFilterType::New();
+    moments->SetInput( labelMap );
+    moments->InPlaceOff();
+    moments->SetLargeLabelObjectNumberOfLines( split ? 1 : 0 );
+    moments->Update();
+
+    for ( LabelPixelType label = 1; label <= 3; ++label )
+      {
+      if ( !CompareLabelObjects( shape->GetOutput()->GetLabelObject( label ),
+                                 moments->GetOutput()->GetLabelObject( label ) ) )
+        {
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // The oriented bounding box computed on top of the lean filter must
+  // match the one computed on top of ShapeLabelMapFilter.
+  typedef itk::OrientedBoundingBoxLabelMapFilter<LabelMapType>                    ShapeOBBFilterType;
+  typedef itk::OrientedBoundingBoxLabelMapFilter<LabelMapType, MomentsFilterType> MomentsOBBFilterType;
+
+  ShapeOBBFilterType::Pointer shapeOBB = ShapeOBBFilterType::New();
+  shapeOBB->SetInput( labelMap );
+  shapeOBB->InPlaceOff();
+  shapeOBB->Update();
+
+  MomentsOBBFilterType::Pointer momentsOBB = MomentsOBBFilterType::New();
+
+  EXERCISE_BASIC_OBJECT_METHODS( momentsOBB, MomentsOBBFilterType );
+
+  // the property of the subclass also drives the moments pass
+  momentsOBB->SetLargeLabelObjectNumberOfLines( 1 );
+  const MomentsFilterType *nestedMoments = momentsOBB.GetPointer();
+  TEST_SET_GET_VALUE( 1u, nestedMoments->GetLargeLabelObjectNumberOfLines() );
+
+  momentsOBB->SetInput( labelMap );
+  momentsOBB->InPlaceOff();
+  momentsOBB->Update();
+
+  const LabelObjectType *expected = shapeOBB->GetOutput()->GetLabelObject( 1 );
+  const LabelObjectType *result = momentsOBB->GetOutput()->GetLabelObject( 1 );
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    if ( !AlmostEqual( expected->GetOrientedBoundingBoxSize()[i], result->GetOrientedBoundingBoxSize()[i] ) )
+      {
+      std::cerr << "OBB size " << result->GetOrientedBoundingBoxSize()
+                << " differs from " << expected->GetOrientedBoundingBoxSize() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
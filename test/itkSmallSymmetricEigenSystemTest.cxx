@@ -0,0 +1,213 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkSmallSymmetricEigenSystem.h"
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+
+// Check that the rows of eigenVectors are an orthonormal, proper
+// rotation of eigenvectors of matrix with ascending eigenvalues.
+template< unsigned int VDimension >
+bool CheckEigenSystem( const itk::Matrix<double, VDimension, VDimension> &matrix )
+{
+  typedef itk::SmallSymmetricEigenSystem<VDimension> EigenSystemType;
+  typename EigenSystemType::VectorType eigenValues;
+  typename EigenSystemType::MatrixType eigenVectors;
+
+  EigenSystemType::Compute( matrix, eigenValues, eigenVectors );
+
+  double scale = 1.0;
+  for ( unsigned int i = 0; i < VDimension; ++i )
+    {
+    for ( unsigned int j = 0; j < VDimension; ++j )
+      {
+      scale = std::max( scale, std::abs( matrix(i,j) ) );
+      }
+    }
+  const double tolerance = 1e-12 * scale;
+
+  bool pass = true;
+  for ( unsigned int i = 0; i < VDimension; ++i )
+    {
+    if ( i > 0 && eigenValues[i] < eigenValues[i-1] )
+      {
+      std::cerr << "Eigenvalues are not ascending" << std::endl;
+      pass = false;
+      }
+
+    for ( unsigned int j = 0; j < VDimension; ++j )
+      {
+      // A v = lambda v
+      double av = 0.0;
+      for ( unsigned int k = 0; k < VDimension; ++k )
+        {
+        av += matrix(j,k) * eigenVectors(i,k);
+        }
+      if ( std::abs( av - eigenValues[i] * eigenVectors(i,j) ) > tolerance )
+        {
+        std::cerr << "Row " << i << " is not an eigenvector" << std::endl;
+        pass = false;
+        }
+
+      // orthonormal rows
+      double dot = 0.0;
+      for ( unsigned int k = 0; k < VDimension; ++k )
+        {
+        dot += eigenVectors(i,k) * eigenVectors(j,k);
+        }
+      if ( std::abs( dot - ( i == j ? 1.0 : 0.0 ) ) > 1e-12 )
+        {
+        std::cerr << "Rows " << i << " and " << j << " are not orthonormal" << std::endl;
+        pass = false;
+        }
+      }
+    }
+
+  double det;
+  if ( VDimension == 2 )
+    {
+    det = eigenVectors(0,0) * eigenVectors(1,1) - eigenVectors(0,1) * eigenVectors(1,0);
+    }
+  else
+    {
+    const unsigned int i2 = 2 % VDimension;
+    det = eigenVectors(0,0) * ( eigenVectors(1,1) * eigenVectors(i2,i2) - eigenVectors(1,i2) * eigenVectors(i2,1) )
+      - eigenVectors(0,1) * ( eigenVectors(1,0) * eigenVectors(i2,i2) - eigenVectors(1,i2) * eigenVectors(i2,0) )
+      + eigenVectors(0,i2) * ( eigenVectors(1,0) * eigenVectors(i2,1) - eigenVectors(1,1) * eigenVectors(i2,0) );
+    }
+  if ( std::abs( det - 1.0 ) > 1e-12 )
+    {
+    std::cerr << "Eigenvectors are not a proper rotation, determinant " << det << std::endl;
+    pass = false;
+    }
+
+  if ( !pass )
+    {
+    std::cerr << "Matrix: " << std::endl << matrix;
+    std::cerr << "Eigenvalues: " << eigenValues << std::endl;
+    std::cerr << "Eigenvectors: " << std::endl << eigenVectors;
+    }
+  return pass;
+}
+
+// Build R^T diag(d) R for a rotation R about the given axis.
+itk::Matrix<double, 3, 3> MakeSymmetric( const double d[3], double angle, const double axis[3] )
+{
+  const double c = std::cos( angle );
+  const double s = std::sin( angle );
+  const double n = std::sqrt( axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2] );
+  const double x = axis[0] / n;
+  const double y = axis[1] / n;
+  const double z = axis[2] / n;
+
+  itk::Matrix<double, 3, 3> r;
+  r(0,0) = c + x*x*(1-c);   r(0,1) = x*y*(1-c) - z*s; r(0,2) = x*z*(1-c) + y*s;
+  r(1,0) = y*x*(1-c) + z*s; r(1,1) = c + y*y*(1-c);   r(1,2) = y*z*(1-c) - x*s;
+  r(2,0) = z*x*(1-c) - y*s; r(2,1) = z*y*(1-c) + x*s; r(2,2) = c + z*z*(1-c);
+
+  itk::Matrix<double, 3, 3> m;
+  for ( unsigned int i = 0; i < 3; ++i )
+    {
+    for ( unsigned int j = 0; j < 3; ++j )
+      {
+      m(i,j) = 0.0;
+      for ( unsigned int k = 0; k < 3; ++k )
+        {
+        m(i,j) += r(k,i) * d[k] * r(k,j);
+        }
+      }
+    }
+  return m;
+}
+
+}
+
+int itkSmallSymmetricEigenSystemTest( int , char ** )
+{
+  bool pass = true;
+
+  // 2x2: general, diagonal, repeated, zero and rank one
+  itk::Matrix<double, 2, 2> m2;
+  m2(0,0) = 3.0; m2(0,1) = 1.5; m2(1,0) = 1.5; m2(1,1) = -2.0;
+  pass = CheckEigenSystem<2>( m2 ) && pass;
+
+  m2.Fill( 0.0 );
+  m2(0,0) = 5.0; m2(1,1) = 1.0;
+  pass = CheckEigenSystem<2>( m2 ) && pass;
+
+  m2.SetIdentity();
+  pass = CheckEigenSystem<2>( m2 ) && pass;
+
+  m2.Fill( 0.0 );
+  pass = CheckEigenSystem<2>( m2 ) && pass;
+
+  m2.Fill( 4.0 );
+  pass = CheckEigenSystem<2>( m2 ) && pass;
+
+  // the eigenvalues of a 2x2 matrix are known in closed form
+  m2(0,0) = 2.0; m2(0,1) = 1.0; m2(1,0) = 1.0; m2(1,1) = 2.0;
+  itk::SmallSymmetricEigenSystem<2>::VectorType values2;
+  itk::SmallSymmetricEigenSystem<2>::MatrixType vectors2;
+  itk::SmallSymmetricEigenSystem<2>::Compute( m2, values2, vectors2 );
+  if ( std::abs( values2[0] - 1.0 ) > 1e-14 || std::abs( values2[1] - 3.0 ) > 1e-14 )
+    {
+    std::cerr << "Wrong eigenvalues " << values2 << std::endl;
+    pass = false;
+    }
+
+  // 3x3: distinct, two and three repeated eigenvalues, rank one and
+  // two, a large dynamic range and zero
+  const double axis[3] = { 0.3, -1.0, 0.7 };
+  const double distinct[3] = { 1.0, 4.0, 9.0 };
+  const double repeated2[3] = { 2.0, 2.0, 7.0 };
+  const double repeated3[3] = { 3.0, 3.0, 3.0 };
+  const double rank1[3] = { 0.0, 0.0, 5.0 };
+  const double rank2[3] = { 0.0, 1.0, 5.0 };
+  const double range[3] = { 1e-6, 1.0, 1e6 };
+  const double negative[3] = { -4.0, 0.5, 2.0 };
+  const double zero[3] = { 0.0, 0.0, 0.0 };
+
+  for ( unsigned int a = 0; a < 8; ++a )
+    {
+    const double angle = 0.4 * a;
+    pass = CheckEigenSystem<3>( MakeSymmetric( distinct, angle, axis ) ) && pass;
+    pass = CheckEigenSystem<3>( MakeSymmetric( repeated2, angle, axis ) ) && pass;
+    pass = CheckEigenSystem<3>( MakeSymmetric( repeated3, angle, axis ) ) && pass;
+    pass = CheckEigenSystem<3>( MakeSymmetric( rank1, angle, axis ) ) && pass;
+    pass = CheckEigenSystem<3>( MakeSymmetric( rank2, angle, axis ) ) && pass;
+    pass = CheckEigenSystem<3>( MakeSymmetric( range, angle, axis ) ) && pass;
+    pass = CheckEigenSystem<3>( MakeSymmetric( negative, angle, axis ) ) && pass;
+    pass = CheckEigenSystem<3>( MakeSymmetric( zero, angle, axis ) ) && pass;
+    }
+
+  // the moments of a single line along x
+  itk::Matrix<double, 3, 3> m3;
+  m3.Fill( 0.0 );
+  m3(0,0) = 6.6666;
+  pass = CheckEigenSystem<3>( m3 ) && pass;
+
+  if ( !pass )
+    {
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}